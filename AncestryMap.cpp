@@ -0,0 +1,336 @@
+//
+//  AncestryMap.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 21.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+#include <limits>
+#include <algorithm>
+
+#include "AncestryMap.h"
+
+using namespace std;
+
+
+// Thread-local buffers marking the ancestors of the particle of the currently used view
+thread_local vector<unsigned int> ancestor_stamps;
+thread_local vector<int> ancestor_ranks;
+thread_local unsigned int ancestor_token = 0;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+AncestryMap::AncestryMap(int n_particles){
+
+    // Use the same grid dimensions as the per-particle maps
+    Map map = Map();
+    this->rows = map.getRows();
+    this->cols = map.getCols();
+    this->cells = vector<vector<Observation>>(this->rows * this->cols);
+    this->row_mutexes = vector<mutex>(this->rows);
+
+    // All particles start at the root of the ancestry tree
+    int root_id = this->add_node(-1);
+    this->nodes[root_id].n_particles = n_particles;
+    this->particle_nodes = vector<int>(n_particles, root_id);
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void AncestryMap::summary(){
+
+    cout << "Ancestry Map:" << endl;
+    cout << "-------------" << endl;
+    cout << "Width: " << this->cols << "px | Height: " << this->rows << "px" << endl;
+    cout << "Number of Nodes: " << this->getNNodes() << endl;
+    cout << "Number of Observations: " << this->getNObservations() << endl;
+}
+
+
+// Total number of observations stored in the grid
+long AncestryMap::getNObservations() const {
+
+    long n_observations = 0;
+    for (vector<vector<Observation>>::const_iterator it = this->cells.begin(); it != this->cells.end(); it++) {
+        n_observations += (long) (*it).size();
+    }
+    return n_observations;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++ Ancestry Tree +++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Reassign particles to the nodes of their sampled ancestors. The number of particles changes to the number of
+// sampled ancestors.
+void AncestryMap::resample(const vector<int>& ancestor_ids){
+
+    // Get nodes of the sampled ancestors before overwriting them
+    const vector<int> ancestor_nodes = this->particle_nodes;
+
+    for (int particle_id = 0; particle_id < (int)ancestor_nodes.size(); particle_id++) {
+        this->nodes[ancestor_nodes[particle_id]].n_particles--;
+    }
+
+    this->particle_nodes.resize(ancestor_ids.size());
+    for (int particle_id = 0; particle_id < (int)ancestor_ids.size(); particle_id++) {
+        this->particle_nodes[particle_id] = ancestor_nodes[ancestor_ids[particle_id]];
+        this->nodes[this->particle_nodes[particle_id]].n_particles++;
+    }
+}
+
+
+// Create a new node for each particle, prune dead branches and merge chains of single children
+void AncestryMap::branch(){
+
+    // Attach a new leaf to the current node of each particle
+    for (int particle_id = 0; particle_id < (int)this->particle_nodes.size(); particle_id++) {
+        const int parent_id = this->particle_nodes[particle_id];
+        const int node_id = this->add_node(parent_id);
+        this->nodes[parent_id].n_particles--;
+        this->nodes[node_id].n_particles = 1;
+        this->nodes[node_id].particle_id = particle_id;
+        this->particle_nodes[particle_id] = node_id;
+    }
+
+    // Remove all nodes without particles and descendants (removal propagates to the parents)
+    for (int node_id = 0; node_id < (int)this->nodes.size(); node_id++) {
+        if (this->nodes[node_id].alive && this->nodes[node_id].n_particles == 0 && this->nodes[node_id].children.empty()) {
+            this->remove_node(node_id);
+        }
+    }
+
+    // Merge nodes without particles into their parent if they are the only child
+    for (int node_id = 0; node_id < (int)this->nodes.size(); node_id++) {
+        while (this->nodes[node_id].alive && this->nodes[node_id].n_particles == 0 && this->nodes[node_id].children.size() == 1) {
+            this->merge_child(node_id);
+        }
+    }
+}
+
+
+// Create a node as child of the specified parent (-1 for the root)
+int AncestryMap::add_node(const int& parent_id){
+
+    // Reuse ID of a removed node if available
+    int node_id;
+    if (this->free_node_ids.empty()) {
+        node_id = (int) this->nodes.size();
+        this->nodes.push_back(AncestryNode());
+    }
+    else {
+        node_id = this->free_node_ids.back();
+        this->free_node_ids.pop_back();
+    }
+
+    AncestryNode& node = this->nodes[node_id];
+    node.parent_id = parent_id;
+    node.children.clear();
+    node.cells.clear();
+    node.n_particles = 0;
+    node.particle_id = -1;
+    node.alive = true;
+
+    if (parent_id >= 0) {
+        this->nodes[parent_id].children.push_back(node_id);
+    }
+
+    return node_id;
+}
+
+
+// Remove a node with all its observations. Parents left without particles and descendants are removed as well.
+void AncestryMap::remove_node(const int& node_id){
+
+    int current_id = node_id;
+    while (current_id >= 0) {
+
+        AncestryNode& node = this->nodes[current_id];
+
+        // Delete observations of the node from the grid
+        for (vector<int>::iterator it = node.cells.begin(); it != node.cells.end(); it++) {
+            vector<Observation>& observations = this->cells[*it];
+            for (int observation_id = 0; observation_id < (int)observations.size(); observation_id++) {
+                if (observations[observation_id].node_id == current_id) {
+                    observations[observation_id] = observations.back();
+                    observations.pop_back();
+                    break;
+                }
+            }
+        }
+        node.cells.clear();
+        node.cells.shrink_to_fit();
+        node.alive = false;
+        this->free_node_ids.push_back(current_id);
+
+        // Detach node from its parent
+        const int parent_id = node.parent_id;
+        if (parent_id < 0) {
+            return; }
+        vector<int>& siblings = this->nodes[parent_id].children;
+        siblings.erase(find(siblings.begin(), siblings.end(), current_id));
+
+        // Continue with the parent if it became a dead leaf
+        if (this->nodes[parent_id].n_particles == 0 && siblings.empty()) {
+            current_id = parent_id; }
+        else {
+            current_id = -1; }
+    }
+}
+
+
+// Merge the only child of a node into the node. Observations of the child replace those of the node, the
+// children and particles of the child are moved to the node.
+void AncestryMap::merge_child(const int& node_id){
+
+    const int child_id = this->nodes[node_id].children[0];
+
+    // Move observations of the child to the node
+    vector<int> child_cells;
+    child_cells.swap(this->nodes[child_id].cells);
+    for (vector<int>::iterator it = child_cells.begin(); it != child_cells.end(); it++) {
+
+        vector<Observation>& observations = this->cells[*it];
+        int node_observation_id = -1;
+        int child_observation_id = -1;
+        for (int observation_id = 0; observation_id < (int)observations.size(); observation_id++) {
+            if (observations[observation_id].node_id == node_id) {
+                node_observation_id = observation_id; }
+            else if (observations[observation_id].node_id == child_id) {
+                child_observation_id = observation_id; }
+        }
+
+        // Overwrite observation of the node or hand over the observation of the child
+        if (node_observation_id >= 0) {
+            observations[node_observation_id].value = observations[child_observation_id].value;
+            observations[child_observation_id] = observations.back();
+            observations.pop_back();
+        }
+        else {
+            observations[child_observation_id].node_id = node_id;
+            this->nodes[node_id].cells.push_back(*it);
+        }
+    }
+
+    // Move children of the child to the node
+    AncestryNode& node = this->nodes[node_id];
+    AncestryNode& child = this->nodes[child_id];
+    node.children.swap(child.children);
+    for (vector<int>::iterator it = node.children.begin(); it != node.children.end(); it++) {
+        this->nodes[*it].parent_id = node_id;
+    }
+
+    // Redirect particle of the child to the node
+    node.n_particles = child.n_particles;
+    node.particle_id = child.particle_id;
+    if (child.n_particles == 1) {
+        this->particle_nodes[child.particle_id] = node_id;
+    }
+
+    // Release the child
+    child.children.clear();
+    child.alive = false;
+    this->free_node_ids.push_back(child_id);
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Grid Access ++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Create view of a particle and mark all ancestors of its node
+AncestryMap::View::View(const AncestryMap& map, const int& particle_id) : map(map) {
+
+    this->node_id = map.particle_nodes[particle_id];
+
+    // Grow buffers if the tree grew
+    if (ancestor_stamps.size() < map.nodes.size()) {
+        ancestor_stamps.resize(map.nodes.size(), 0);
+        ancestor_ranks.resize(map.nodes.size(), 0);
+    }
+
+    // New token invalidates marks of the previous view, reset buffers when the token overflows
+    ancestor_token++;
+    if (ancestor_token == 0) {
+        fill(ancestor_stamps.begin(), ancestor_stamps.end(), 0);
+        ancestor_token = 1;
+    }
+    this->token = ancestor_token;
+
+    // Mark ancestors with their distance from the particle's node
+    int rank = 0;
+    for (int ancestor_id = this->node_id; ancestor_id >= 0; ancestor_id = map.nodes[ancestor_id].parent_id, rank++) {
+        ancestor_stamps[ancestor_id] = this->token;
+        ancestor_ranks[ancestor_id] = rank;
+    }
+
+    this->stamps = ancestor_stamps.data();
+    this->ranks = ancestor_ranks.data();
+}
+
+
+// Value of a grid cell as seen by the particle, i.e. the observation of its nearest ancestor
+uchar AncestryMap::View::getValue(const int& x_px, const int& y_px) const {
+
+    const vector<Observation>& observations = this->map.cells[y_px * this->map.cols + x_px];
+
+    // Unobserved cells are unknown
+    uchar value = (uchar) Map::getThreshold();
+    int best_rank = numeric_limits<int>::max();
+    for (vector<Observation>::const_iterator it = observations.begin(); it != observations.end(); it++) {
+        if (this->stamps[(*it).node_id] == this->token && this->ranks[(*it).node_id] < best_rank) {
+            best_rank = this->ranks[(*it).node_id];
+            value = (*it).value;
+        }
+    }
+
+    return value;
+}
+
+
+// Update occupancy value of a grid cell for a particle. The new value is stored as observation of the
+// particle's node, observations of its ancestors are left untouched.
+void AncestryMap::update(const View& view, const int& x_px, const int& y_px, const int& occupancy_update){
+
+    // Get current and updated value
+    const uchar value = view.getValue(x_px, y_px);
+    const uchar new_value = Map::updateValue(value, occupancy_update);
+    if (new_value == value) {
+        return; }
+
+    // Overwrite observation of the particle's node if available, otherwise add a new one
+    const int cell_id = y_px * this->cols + x_px;
+    vector<Observation>& observations = this->cells[cell_id];
+    for (vector<Observation>::iterator it = observations.begin(); it != observations.end(); it++) {
+        if ((*it).node_id == view.getNodeID()) {
+            (*it).value = new_value;
+            return;
+        }
+    }
+    observations.push_back({view.getNodeID(), new_value});
+    this->nodes[view.getNodeID()].cells.push_back(cell_id);
+}
+
+
+// Compose grid as seen by a particle
+cv::Mat AncestryMap::getData(const int& particle_id) const {
+
+    cv::Mat data = cv::Mat(this->rows, this->cols, CV_8UC1);
+    View view(*this, particle_id);
+    for (int y_px = 0; y_px < this->rows; y_px++) {
+        uchar* row_ptr = data.ptr<uchar>(y_px);
+        for (int x_px = 0; x_px < this->cols; x_px++) {
+            row_ptr[x_px] = view.getValue(x_px, y_px);
+        }
+    }
+    return data;
+}
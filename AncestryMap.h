@@ -0,0 +1,113 @@
+//
+//  AncestryMap.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 21.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef AncestryMap_h
+#define AncestryMap_h
+
+#include <vector>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+
+#include "Map.h"
+
+using namespace std;
+
+// Occupancy value written to a grid cell by a node of the ancestry tree
+typedef struct {
+    int node_id;
+    uchar value;
+} Observation;
+
+// Node of the ancestry tree. Every node owns the observations its particles made while they shared the node.
+typedef struct {
+    int parent_id; // -1 for the root
+    vector<int> children; // IDs of all child nodes
+    vector<int> cells; // IDs of all cells holding an observation of this node
+    int n_particles; // number of particles currently assigned to this node
+    int particle_id; // particle assigned to the node (valid if n_particles is 1)
+    bool alive;
+} AncestryNode;
+
+
+// Map representation shared by all particles (DP-SLAM). Instead of one grid per particle, a single grid stores
+// for each cell the observations of all nodes of the particles' ancestry tree. A particle sees the value written
+// by its nearest ancestor. Nodes that have no descendants anymore are pruned and chains of single children are
+// merged, so the tree stays small and the memory scales with the number of particles times the area they
+// observed since their lineages split.
+class AncestryMap {
+
+    public:
+        // Map as seen by a single particle. The ancestors of the particle are marked in thread-local
+        // buffers, so only one view per thread can be used at a time.
+        class View {
+
+            public:
+                View(const AncestryMap& map, const int& particle_id);
+
+                // Value of a grid cell as seen by the particle
+                uchar getValue(const int& x_px, const int& y_px) const;
+
+                // Getter functions
+                const int& getRows() const { return this->map.rows; };
+                const int& getCols() const { return this->map.cols; };
+                const int& getNodeID() const { return this->node_id; };
+
+            private:
+                const AncestryMap& map;
+                int node_id; // node of the particle
+                unsigned int token; // marks the ancestors of the particle in the thread-local buffers
+                const unsigned int* stamps; // ancestor marks of all nodes
+                const int* ranks; // distance of the marked ancestors from the particle's node
+        };
+
+        // Constructor and destructor
+        AncestryMap(int n_particles);
+        ~AncestryMap(){};
+
+        // Print summary of ancestry map
+        void summary();
+
+        // Reassign particles to the nodes of their sampled ancestors, the number of particles may change
+        void resample(const vector<int>& ancestor_ids);
+
+        // Create a new node for each particle, prune dead branches and merge chains of single children. Has to
+        // be called before the particles write their observations of the current step.
+        void branch();
+
+        // Update occupancy value of a grid cell for a particle. Rows have to be locked by the caller.
+        void update(const View& view, const int& x_px, const int& y_px, const int& occupancy_update);
+
+        // Lock for a row of the grid, particles update the grid in parallel
+        mutex& getRowMutex(const int& y_px){ return this->row_mutexes[y_px]; };
+
+        // Compose grid as seen by a particle
+        cv::Mat getData(const int& particle_id) const;
+
+        // Getter functions
+        const int& getRows() const { return this->rows; };
+        const int& getCols() const { return this->cols; };
+        int getNNodes() const { return (int) this->nodes.size() - (int) this->free_node_ids.size(); };
+        long getNObservations() const;
+
+    private:
+        // Node management
+        int add_node(const int& parent_id);
+        void remove_node(const int& node_id);
+        void merge_child(const int& node_id);
+
+        int rows; // height of the grid in px
+        int cols; // width of the grid in px
+        vector<vector<Observation>> cells; // observations of all nodes for each cell
+        vector<AncestryNode> nodes; // nodes of the ancestry tree
+        vector<int> free_node_ids; // IDs of removed nodes that can be reused
+        vector<int> particle_nodes; // node of each particle
+        vector<mutex> row_mutexes; // locks for the rows of the grid
+
+};
+
+#endif /* AncestryMap_h */
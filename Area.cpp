@@ -9,6 +9,7 @@
 
 #include <stdio.h>
 #include "Area.h"
+#include "Tracer.h"
 
 class Map;
 
@@ -95,11 +96,29 @@ void Area::summary(){
 // Draw entire scene content according to specified verbosity level
 void Area::drawScene(int verbose){
         
+        TRACE_SCOPE("draw_scene");
+        
         // ++++++++++++++++++++++++++++++++++++ Draw Static Content ++++++++++++++++++++++++++++++++++++++++++
 
-        // Draw robot path. Path is drawn before copying data to display all past locations of robot.
+        // Draw robot path. Path is drawn before rendering dynamic content to display all past locations of
+        // robot.
         this->drawPath();
-            
+    
+    
+        // Render dynamic content
+        this->renderScene(verbose);
+
+        // Display current scene
+        cv::imshow("Area", this->scene_data);
+        cv::waitKey(1);
+    
+}
+
+
+// Render dynamic scene content on top of the static scene into the scene data without displaying it
+void Area::renderScene(int verbose){
+    
+        TRACE_SCOPE("render_scene");
     
         // +++++++++++++++++++++++++++++++++++++++ Create Copy +++++++++++++++++++++++++++++++++++++++++++++++
 
@@ -128,10 +147,6 @@ void Area::drawScene(int verbose){
     
         // Assign complete scene data for current time step to variable for result saving
         this->data.copyTo(this->scene_data);
-
-        // Display current scene
-        cv::imshow("Area", this->data);
-        cv::waitKey(1);
     
         // Restore static scene data
         this->data = data_copy;
@@ -217,22 +232,25 @@ void Area::drawScan(){
 // Draw laser scan estimate for each particle
 void Area::drawScanEstimate(){
     
-    for (list<Particle>::iterator it = this->robot.getFilter().getParticles().begin(); it != this->robot.getFilter().getParticles().end(); it++) {
+    // Get reference to the filter's particles
+    ParticleSet& particles = this->robot.getFilter().getParticles();
+    
+    for (int particle_id = 0; particle_id < particles.size(); particle_id++) {
         
         // Get particle location in continuous world coordinates
-        const Eigen::Vector2f particle_location = (*it).getPose().block<2,1>(0,0);
+        const Eigen::Vector2f particle_location = particles.getPose(particle_id).block<2,1>(0,0);
         
         // Get particle heading
-        const float particle_heading = (*it).getPose()(2);
+        const float particle_heading = particles.getPose(particle_id)(2);
         
         // Get particle location in discrete area coordinates
         const Eigen::Vector2i area_particle_location = this->discretize_world_location(particle_location);
         
-        // Get number of measurements
-        const int n_beams = this->robot.getSensor().getN();
-        
         // Get reference to estimated measurements
-        const Eigen::MatrixX2f measurement_estimate_ref = (*it).getMeasurementEstimate();
+        const Eigen::MatrixX2f measurement_estimate_ref = particles.getMeasurementEstimate(particle_id);
+        
+        // Get number of measurements (no estimate is available if scans are matched directly to the map)
+        const int n_beams = (int) measurement_estimate_ref.rows();
         
         // Iterate over all estimated measurements
         for (int beam_id = 0; beam_id < n_beams; beam_id++) {
@@ -289,11 +307,14 @@ void Area::drawRobot(){
 // Draw Particles
 void Area::drawParticles(){
     
+    // Get reference to the filter's particles
+    ParticleSet& particles = this->robot.getFilter().getParticles();
+    
     // Iterate over all particles
-    for (list<Particle>::iterator it = this->robot.getFilter().getParticles().begin(); it != this->robot.getFilter().getParticles().end(); it++) {
+    for (int particle_id = 0; particle_id < particles.size(); particle_id++) {
         
         // Get particle location in continuous world coordinates
-        const Eigen::Vector2f particle_location = (*it).getPose().block<2,1>(0,0);
+        const Eigen::Vector2f particle_location = particles.getPose(particle_id).block<2,1>(0,0);
         
         // Get particle location in discrete area coordinates
         const Eigen::Vector2i area_particle_location = this->discretize_world_location(particle_location);
@@ -23,7 +23,8 @@ class Area{
     ~Area(){};
     
     // Drawing functions
-    void drawScene(int verbose);
+    void drawScene(int verbose); // render and display scene
+    void renderScene(int verbose); // render scene for result saving without displaying it
     void drawPath();
     void drawRobot();
     void drawWalls();
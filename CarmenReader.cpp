@@ -0,0 +1,328 @@
+//
+//  CarmenReader.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 09.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits>
+
+#include "CarmenReader.h"
+
+using namespace std;
+
+#define PI 3.14159265
+
+
+// Parse n whitespace separated numbers, p is advanced behind the last number. Returns false if the line ends
+// early or contains something else.
+static bool parse_values(const char*& p, const int& n, double* values){
+    for (int value_id = 0; value_id < n; value_id++) {
+        char* end;
+        values[value_id] = strtod(p, &end);
+        if (end == p) {
+            return false; }
+        p = end;
+    }
+    return true;
+}
+
+// Parse ranges of a scan preceded by their number
+static bool parse_ranges(const char*& p, vector<float>& ranges){
+    double n_ranges;
+    if (!parse_values(p, 1, &n_ranges) || n_ranges < 0) {
+        return false; }
+    ranges.resize((size_t) n_ranges);
+    for (size_t range_id = 0; range_id < ranges.size(); range_id++) {
+        char* end;
+        ranges[range_id] = strtof(p, &end);
+        if (end == p) {
+            return false; }
+        p = end;
+    }
+    return true;
+}
+
+// Angle difference in range [-pi, pi]
+static float angle_difference(const float& a, const float& b){
+    return atan2(sin(a - b), cos(a - b));
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Constructor, reads the first scan as initial scan of the replay
+CarmenReader::CarmenReader(const string& file_path, const float& max_range, const int& lookahead){
+
+    this->file_path = file_path;
+    this->file.open(file_path);
+    if (!this->file.is_open()) {
+        cout << "Unable to open CARMEN log " << file_path << "!" << endl;
+        exit(1);
+    }
+    this->n_lines = 0;
+    this->n_skipped = 0;
+    this->end_reached = false;
+    this->lookahead = max(lookahead, 1);
+    this->n_scans = 0;
+
+    // Sensor geometry is taken from the first scan
+    CarmenScan scan;
+    if (!this->fetch_scan(scan)) {
+        cout << "No laser scans (FLASER or RAWLASER1) found in CARMEN log " << file_path << "!" << endl;
+        exit(1);
+    }
+    this->n_beams = (int) scan.ranges.size();
+    if (this->n_beams < 2) {
+        cout << "CARMEN log " << file_path << " contains scans with less than two beams!" << endl;
+        exit(1);
+    }
+    this->start_angle = scan.start_angle * 180 / PI;
+    this->resolution = scan.angular_resolution * 180 / PI;
+    this->FoV = this->resolution * (this->n_beams - 1);
+    this->range = min(max_range, scan.max_range);
+    this->ranges = Eigen::VectorXf::Zero(this->n_beams);
+
+    Eigen::Vector3f odometry_pose;
+    if (!scan.has_pose && !this->odometry_at(scan.timestamp, odometry_pose)) {
+        cout << "No odometry (ODOM) found in CARMEN log " << file_path << "!" << endl;
+        exit(1);
+    }
+    this->set_scan(scan, scan.has_pose ? scan.pose : odometry_pose);
+
+    // Nominal sampling time from the first two scans (1s for logs with a single scan or equal timestamps)
+    this->sampling_time = 1.0;
+    if (!this->isLast() && this->scan_messages.front().timestamp > this->first_timestamp) {
+        this->sampling_time = (float) (this->scan_messages.front().timestamp - this->first_timestamp); }
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void CarmenReader::summary(){
+
+    cout << "CARMEN Log:" << endl;
+    cout << "-----------" << endl;
+    cout << "File: " << this->file_path << endl;
+    cout << "Laser Message: " << this->laser_message << endl;
+    cout << "Sampling Time: " << this->sampling_time << "s" << endl;
+    cout << "FoV: " << this->FoV << "°" << endl;
+    cout << "Range: " << this->range << "m" << endl;
+    cout << "Resolution: " << this->resolution << "°" << endl;
+    cout << "Start Angle: " << this->start_angle << "°" << endl;
+    cout << "Number of Measurements: " << this->n_beams << endl;
+    cout << "Lookahead: " << this->lookahead << " messages" << endl;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++ Replay ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Advance to the next scan
+bool CarmenReader::next(){
+
+    CarmenScan scan;
+    if (!this->fetch_scan(scan)) {
+        return false; }
+
+    Eigen::Vector3f odometry_pose;
+    if (scan.has_pose) {
+        odometry_pose = scan.pose; }
+    else if (!this->odometry_at(scan.timestamp, odometry_pose)) {
+        cout << "No odometry for scan at line " << this->n_lines << " of CARMEN log " << this->file_path << "!" << endl;
+        exit(1);
+    }
+    this->set_scan(scan, odometry_pose);
+
+    return true;
+}
+
+// Check if another scan follows the current scan
+bool CarmenReader::isLast(){
+
+    while (this->scan_messages.empty() && this->read_message()) {}
+    return this->scan_messages.empty();
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++++ Messages +++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Read lines until one message was parsed
+bool CarmenReader::read_message(){
+
+    while (getline(this->file, this->line)) {
+
+        this->n_lines++;
+
+        // Message name
+        const char* p = this->line.c_str();
+        while (*p == ' ' || *p == '\t') {
+            p++; }
+        const char* name_end = p;
+        while (*name_end != '\0' && *name_end != ' ' && *name_end != '\t') {
+            name_end++; }
+        const string name(p, name_end);
+        p = name_end;
+
+        // ODOM x y theta tv rv accel timestamp hostname logger_timestamp
+        if (name == "ODOM") {
+            double values[7];
+            if (!parse_values(p, 7, values)) {
+                this->n_skipped++;
+                continue;
+            }
+            CarmenOdometry odometry;
+            odometry.timestamp = values[6];
+            odometry.pose << (float) values[0], (float) values[1], (float) values[2];
+            this->odometry_messages.push_back(odometry);
+            if ((int) this->odometry_messages.size() > this->lookahead) {
+                this->odometry_messages.pop_front(); }
+            return true;
+        }
+
+        // Only scans of a single laser are replayed
+        if ((name != "FLASER" && name != "RAWLASER1") || (!this->laser_message.empty() && name != this->laser_message)) {
+            continue; }
+
+        CarmenScan scan;
+        bool parsed;
+        // FLASER n range_1 ... range_n x y theta odom_x odom_y odom_theta timestamp hostname logger_timestamp
+        if (name == "FLASER") {
+            double values[7] = {0};
+            parsed = parse_ranges(p, scan.ranges) && parse_values(p, 7, values);
+            // FLASER messages contain front lasers covering 180° from -90°, the beam count sets the resolution
+            scan.start_angle = -PI / 2;
+            scan.angular_resolution = PI / max((int) scan.ranges.size(), 1);
+            scan.max_range = numeric_limits<float>::infinity();
+            scan.has_pose = true;
+            scan.pose << (float) values[3], (float) values[4], (float) values[5];
+            scan.timestamp = values[6];
+        }
+        // RAWLASER1 laser_type start_angle field_of_view angular_resolution maximum_range accuracy remission_mode
+        // n range_1 ... range_n n_remissions remission_1 ... remission_n timestamp hostname logger_timestamp
+        else {
+            double values[7] = {0};
+            vector<float> remissions;
+            parsed = parse_values(p, 7, values) && parse_ranges(p, scan.ranges) && parse_ranges(p, remissions) &&
+                     parse_values(p, 1, &scan.timestamp);
+            scan.start_angle = (float) values[1];
+            scan.angular_resolution = (float) values[3];
+            scan.max_range = (float) values[4];
+            scan.has_pose = false;
+        }
+        if (!parsed) {
+            this->n_skipped++;
+            continue;
+        }
+
+        if (this->laser_message.empty()) {
+            this->laser_message = name; }
+        this->scan_messages.push_back(move(scan));
+        return true;
+    }
+
+    // Report malformed lines once at the end of the file
+    if (this->n_skipped > 0 && !this->end_reached) {
+        cout << "Skipped " << this->n_skipped << " malformed lines of CARMEN log " << this->file_path << "." << endl; }
+    this->end_reached = true;
+
+    return false;
+}
+
+// Get next scan
+bool CarmenReader::fetch_scan(CarmenScan& scan){
+
+    while (this->scan_messages.empty() && this->read_message()) {}
+    if (this->scan_messages.empty()) {
+        return false; }
+
+    scan = move(this->scan_messages.front());
+    this->scan_messages.pop_front();
+    return true;
+}
+
+// Odometry pose at a point in time
+bool CarmenReader::odometry_at(const double& timestamp, Eigen::Vector3f& odometry_pose){
+
+    // Read ahead until odometry after the timestamp is available or the lookahead is exhausted
+    while ((this->odometry_messages.empty() || this->odometry_messages.back().timestamp < timestamp) &&
+           (int) this->scan_messages.size() < this->lookahead && this->read_message()) {}
+    if (this->odometry_messages.empty()) {
+        return false; }
+
+    // Drop odometry before the last message preceding the timestamp
+    while (this->odometry_messages.size() >= 2 && this->odometry_messages[1].timestamp <= timestamp) {
+        this->odometry_messages.pop_front(); }
+
+    // Use the closest message if the timestamp is not enclosed by two messages
+    const CarmenOdometry& before = this->odometry_messages[0];
+    if (this->odometry_messages.size() == 1 || before.timestamp >= timestamp) {
+        odometry_pose = before.pose;
+        return true;
+    }
+
+    // Interpolate linearly between the enclosing messages
+    const CarmenOdometry& after = this->odometry_messages[1];
+    const float f = (float) ((timestamp - before.timestamp) / (after.timestamp - before.timestamp));
+    odometry_pose.head<2>() = (1 - f) * before.pose.head<2>() + f * after.pose.head<2>();
+    odometry_pose(2) = before.pose(2) + f * angle_difference(after.pose(2), before.pose(2));
+    return true;
+}
+
+// Set current scan
+void CarmenReader::set_scan(const CarmenScan& scan, const Eigen::Vector3f& odometry_pose){
+
+    if ((int) scan.ranges.size() != this->n_beams) {
+        cout << "Number of beams changed at line " << this->n_lines << " of CARMEN log " << this->file_path << "!" << endl;
+        exit(1);
+    }
+
+    // Reference for relative poses and timestamps
+    if (this->n_scans == 0) {
+        this->first_timestamp = scan.timestamp;
+        this->first_pose = odometry_pose;
+        this->odometry_signal = Eigen::Vector2f::Zero();
+    }
+    // Velocities that move the previous odometry pose to the current one within the time between the scans
+    else {
+        const double delta_t = scan.timestamp - this->last_timestamp;
+        this->odometry_signal = Eigen::Vector2f::Zero();
+        if (delta_t > 0) {
+            const float theta = this->last_odometry_pose(2);
+            const Eigen::Vector2f delta = odometry_pose.head<2>() - this->last_odometry_pose.head<2>();
+            this->odometry_signal(0) = (float) ((cos(theta) * delta(0) + sin(theta) * delta(1)) / delta_t);
+            this->odometry_signal(1) = (float) (angle_difference(odometry_pose(2), theta) / delta_t);
+        }
+    }
+
+    // Pose relative to the first scan
+    const float cos_t = cos(this->first_pose(2));
+    const float sin_t = sin(this->first_pose(2));
+    const Eigen::Vector2f delta = odometry_pose.head<2>() - this->first_pose.head<2>();
+    this->pose(0) = cos_t * delta(0) + sin_t * delta(1);
+    this->pose(1) = -sin_t * delta(0) + cos_t * delta(1);
+    this->pose(2) = angle_difference(odometry_pose(2), this->first_pose(2));
+    this->timestamp = (float) (scan.timestamp - this->first_timestamp);
+
+    // Missing and out of range readings are set to the maximum range (no obstacle detected)
+    for (int beam_id = 0; beam_id < this->n_beams; beam_id++) {
+        const float range = scan.ranges[beam_id];
+        this->ranges(beam_id) = (range > 0 && range < this->range) ? range : this->range;
+    }
+
+    this->last_timestamp = scan.timestamp;
+    this->last_odometry_pose = odometry_pose;
+    this->n_scans++;
+}
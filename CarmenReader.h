@@ -0,0 +1,125 @@
+//
+//  CarmenReader.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 09.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef CarmenReader_h
+#define CarmenReader_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <Eigen/Dense>
+
+using namespace std;
+
+// Odometry pose of the robot at a point in time
+typedef struct {
+    double timestamp;
+    Eigen::Vector3f pose;
+} CarmenOdometry;
+
+// Laser scan and, if contained in the message, the odometry pose of the robot at the time of the scan
+typedef struct {
+    double timestamp;
+    float start_angle; // angle of the first beam relative to the robot's heading in rad
+    float angular_resolution; // angle between two beams in rad
+    float max_range; // maximum range of the laser in m
+    vector<float> ranges;
+    bool has_pose;
+    Eigen::Vector3f pose;
+} CarmenScan;
+
+
+// Streaming reader for CARMEN text logs (ODOM, FLASER and RAWLASER1 messages). The log is parsed line by line
+// while it is replayed, only a bounded number of messages is read ahead to find the odometry around a scan, so
+// memory does not grow with the size of the log. Every scan is one step of the filter. Odometry poses at the
+// scans are taken from FLASER messages or interpolated between ODOM messages for RAWLASER1 and converted to the
+// translational and angular velocity since the previous scan. Poses and timestamps are given relative to the
+// first scan, which is the initial scan of the replay.
+class CarmenReader {
+
+    public:
+        // Constructor and destructor, reads the first scan to determine the sensor geometry
+        CarmenReader(const string& file_path, const float& max_range, const int& lookahead = 256);
+        ~CarmenReader(){};
+
+        // Print reader summary
+        void summary();
+
+        // Advance to the next scan, returns false at the end of the log
+        bool next();
+
+        // Check if the current scan is the last scan of the log
+        bool isLast();
+
+        // Getters of the current scan
+        const float& getTimestamp() const { return this->timestamp; };
+        const Eigen::Vector2f& getOdometry() const { return this->odometry_signal; };
+        const Eigen::Vector3f& getPose() const { return this->pose; };
+        const Eigen::VectorXf& getRanges() const { return this->ranges; };
+
+        // Sensor getters
+        const float& getFoV() const { return this->FoV; };
+        const float& getRange() const { return this->range; };
+        const float& getResolution() const { return this->resolution; };
+        const float& getStartAngle() const { return this->start_angle; };
+        const int& getNBeams() const { return this->n_beams; };
+        const float& getSamplingTime() const { return this->sampling_time; };
+
+    private:
+        // Read lines until one message was parsed and buffered, returns false at the end of the file
+        bool read_message();
+
+        // Get next buffered scan or read until the next scan, returns false at the end of the file
+        bool fetch_scan(CarmenScan& scan);
+
+        // Odometry pose at a point in time, interpolated between the surrounding ODOM messages
+        bool odometry_at(const double& timestamp, Eigen::Vector3f& odometry_pose);
+
+        // Set current scan, odometry signal and relative pose from a scan and the odometry pose at the scan
+        void set_scan(const CarmenScan& scan, const Eigen::Vector3f& odometry_pose);
+
+        // Log file
+        string file_path;
+        ifstream file;
+        string line; // buffer of the current line
+        long n_lines; // number of lines read
+        long n_skipped; // number of malformed lines
+        bool end_reached; // end of the file was reached
+
+        // Messages read ahead
+        int lookahead; // maximum number of buffered messages of each type
+        deque<CarmenOdometry> odometry_messages;
+        deque<CarmenScan> scan_messages;
+
+        // Sensor geometry of the first scan
+        string laser_message; // message type of the replayed scans (FLASER or RAWLASER1)
+        float FoV; // field of view in degree (angle between first and last beam)
+        float range; // maximum range in m, longer ranges are set to the maximum range
+        float resolution; // angle between two beams in degree
+        float start_angle; // angle of the first beam relative to the robot's heading in degree
+        int n_beams; // number of ranges per scan
+        float sampling_time; // time between the first two scans in s
+
+        // Reference of relative poses and timestamps
+        double first_timestamp;
+        Eigen::Vector3f first_pose;
+
+        // Current scan
+        long n_scans; // number of scans read
+        double last_timestamp; // absolute timestamp of the previous scan
+        Eigen::Vector3f last_odometry_pose; // odometry pose of the previous scan
+        float timestamp; // time since the first scan in s
+        Eigen::Vector2f odometry_signal; // translational and angular velocity since the previous scan
+        Eigen::Vector3f pose; // odometry pose relative to the first scan
+        Eigen::VectorXf ranges;
+
+};
+
+#endif /* CarmenReader_h */
@@ -0,0 +1,91 @@
+//
+//  CorrelativeMatcher.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 03.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+
+#include "CorrelativeMatcher.h"
+
+using namespace std;
+
+#define PI 3.14159265
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Standard constructor
+CorrelativeMatcher::CorrelativeMatcher(){
+    
+    this->linear_window = 0.5;
+    this->angular_window = 10 * PI / 180;
+    this->n_iterations = 0;
+}
+
+
+// Constructor
+CorrelativeMatcher::CorrelativeMatcher(float linear_window, float angular_window): linear_window(linear_window), angular_window(angular_window) {
+    
+    this->n_iterations = 0;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void CorrelativeMatcher::summary(){
+    
+    cout << "Correlative Matcher: " << endl;
+    cout << "-------------------" << endl;
+    cout << "Linear Window: " << this->linear_window << "m" << endl;
+    cout << "Angular Window: " << this->angular_window << "rad" << endl;
+
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Branch and Bound +++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Refine candidates of a level sorted by their score. A candidate on a level covers the offsets of the
+// 2^level x 2^level cells starting at its offset and its score is an upper bound of their scores.
+void CorrelativeMatcher::branch(const int& level, MatchCandidate* candidates, const int& n_candidates, MatchCandidate& best){
+    
+    for (int candidate_id = 0; candidate_id < n_candidates; candidate_id++) {
+        
+        // Remaining candidates cannot beat the best pose
+        const MatchCandidate& candidate = candidates[candidate_id];
+        if (candidate.score <= best.score) {
+            return; }
+        
+        // Scores on the finest level are exact
+        if (level == 0) {
+            best = candidate;
+            return;
+        }
+        
+        // Split candidate into the four candidates of the next finer level
+        MatchCandidate children[4];
+        int n_children = 0;
+        const int half_step = 1 << (level - 1);
+        for (int x_step = 0; x_step < 2; x_step++) {
+            for (int y_step = 0; y_step < 2; y_step++) {
+                MatchCandidate child = {candidate.x_offset + x_step * half_step, candidate.y_offset + y_step * half_step, candidate.angle_id, 0};
+                if (child.x_offset > this->window_px || child.y_offset > this->window_px) {
+                    continue; }
+                child.score = this->score(child, level - 1);
+                children[n_children++] = child;
+            }
+        }
+        this->n_iterations += n_children;
+        sort(children, children + n_children, [](const MatchCandidate& a, const MatchCandidate& b){ return a.score > b.score; });
+        
+        this->branch(level - 1, children, n_children, best);
+    }
+}
@@ -0,0 +1,269 @@
+//
+//  CorrelativeMatcher.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 03.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef CorrelativeMatcher_h
+#define CorrelativeMatcher_h
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <Eigen/Dense>
+
+#include "Map.h"
+
+using namespace std;
+
+// Candidate pose of the correlative search, offsets in px and index of the heading
+typedef struct {
+    int x_offset;
+    int y_offset;
+    int angle_id;
+    float score;
+} MatchCandidate;
+
+
+// Correlative scan matcher. All poses of an (x, y, theta) window around the particle's pose are scored by the
+// summed occupancy of the cells hit by the measured beams, weighted by a gaussian prior on the correction with
+// 3 standard deviations of the motion model uncertainty. The search is exhaustive but uses branch-and-bound: candidates are
+// first scored on coarse levels of a max-pooled pyramid of the map, whose scores are upper bounds for all poses
+// they cover, and only those that can beat the best pose found so far are refined. The pyramid is built over
+// the region of the map covered by the search window only.
+class CorrelativeMatcher {
+
+    public:
+        // Constructor and destructor
+        CorrelativeMatcher();
+        CorrelativeMatcher(float linear_window, float angular_window);
+        ~CorrelativeMatcher(){};
+
+        // Print correlative matcher summary
+        void summary();
+
+        // Compute pose correction aligning the measurements (angle, range) taken at pose to the grid. Grid is
+        // any type providing getValue(x_px, y_px), getRows() and getCols().
+        template<typename Grid>
+        Eigen::Vector3f match(const Grid& map, const Eigen::Vector3f& pose, const Eigen::MatrixX2f& measurements,
+                              const float& range, const Eigen::Vector3f R);
+
+        // Number of scored candidates since the last reset
+        const long& getNIterations(){ return this->n_iterations; };
+        void resetNIterations(){ this->n_iterations = 0; };
+
+    private:
+        // Score of a candidate on a level of the pyramid, upper bound for all poses covered by the candidate
+        float score(const MatchCandidate& candidate, const int& level) const;
+
+        // Refine candidates of a level sorted by their score, the best pose at full resolution is stored in best
+        void branch(const int& level, MatchCandidate* candidates, const int& n_candidates, MatchCandidate& best);
+
+        float linear_window; // search window on x and y in m
+        float angular_window; // search window on the heading in rad
+        long n_iterations; // number of scored candidates since the last reset
+
+        // Workspaces
+        int n_hits; // number of beams hitting an obstacle
+        int window_px; // search window on x and y in px
+        float angle_step; // heading step in rad
+        int n_angle_steps; // number of heading steps on each side of the pose's heading
+        float prior_linear; // standard deviation of the prior on the correction on x and y in px
+        float prior_angular; // standard deviation of the prior on the heading correction in rad
+        int crop_x; // origin of the cropped region in px
+        int crop_y;
+        int crop_width; // size of the cropped region in px
+        int crop_height;
+        vector<Eigen::Vector2f> hits; // beam endpoints in the sensor frame
+        vector<Eigen::Vector2i> endpoints; // beam endpoints of all headings relative to the cropped region
+        vector<float> pyramid; // max-pooled occupancy of the cropped region for all levels
+        vector<MatchCandidate> candidates; // candidates of the coarsest level
+
+};
+
+
+// Score of a candidate on a level of the pyramid. The summed occupancy is weighted with the prior of the
+// smallest correction covered by the candidate, i.e. the offsets [offset, offset + 2^level) on x and y.
+inline float CorrelativeMatcher::score(const MatchCandidate& candidate, const int& level) const {
+
+    const float* grid = this->pyramid.data() + (size_t) level * this->crop_width * this->crop_height;
+    const Eigen::Vector2i* points = this->endpoints.data() + (size_t) candidate.angle_id * this->n_hits;
+
+    float sum = 0;
+    for (int hit_id = 0; hit_id < this->n_hits; hit_id++) {
+        const int x = points[hit_id](0) + candidate.x_offset;
+        const int y = points[hit_id](1) + candidate.y_offset;
+        if (x >= 0 && y >= 0 && x < this->crop_width && y < this->crop_height) {
+            sum += grid[y * this->crop_width + x]; }
+    }
+
+    // Smallest offsets covered by the candidate
+    const int size = 1 << level;
+    const int x_min = (candidate.x_offset > 0) ? candidate.x_offset : min(0, candidate.x_offset + size - 1);
+    const int y_min = (candidate.y_offset > 0) ? candidate.y_offset : min(0, candidate.y_offset + size - 1);
+    const float angle = (candidate.angle_id - this->n_angle_steps) * this->angle_step;
+
+    // Gaussian prior on the correction
+    const float linear_cost = (x_min * x_min + y_min * y_min) / (this->prior_linear * this->prior_linear);
+    const float angular_cost = angle * angle / (this->prior_angular * this->prior_angular);
+    return sum * exp(-0.5f * (linear_cost + angular_cost));
+}
+
+
+// Exhaustive branch-and-bound search over the pose window
+template<typename Grid>
+Eigen::Vector3f CorrelativeMatcher::match(const Grid& map, const Eigen::Vector3f& pose, const Eigen::MatrixX2f& measurements,
+                                          const float& range, const Eigen::Vector3f R){
+
+    Eigen::Vector3f pose_dif = Eigen::Vector3f::Zero();
+
+    // Scale from world coordinates to continuous map coordinates
+    const float scale_x = Map::getWidth() / Map::getResolution() / (Map::getXMax() - Map::getXMin());
+    const float scale_y = Map::getHeight() / Map::getResolution() / (Map::getYMax() - Map::getYMin());
+
+    // Get endpoints of all beams that hit an obstacle
+    this->hits.clear();
+    float max_hit_range = 0;
+    for (int beam_id = 0; beam_id < measurements.rows(); beam_id++) {
+        if (measurements(beam_id, 1) < range) {
+            this->hits.push_back(Eigen::Vector2f(measurements(beam_id, 1) * cos(measurements(beam_id, 0)),
+                                                 measurements(beam_id, 1) * sin(measurements(beam_id, 0))));
+            max_hit_range = max(max_hit_range, (float) measurements(beam_id, 1));
+        }
+    }
+    this->n_hits = (int) this->hits.size();
+    if (this->n_hits == 0) {
+        return pose_dif; }
+
+    // Heading step moving the farthest endpoint by at most one cell
+    const float max_hit_px = max(max_hit_range * scale_x, 1.0f);
+    this->angle_step = acos(1.0f - 1.0f / (2.0f * max_hit_px * max_hit_px));
+    this->n_angle_steps = (int) ceil(this->angular_window / this->angle_step);
+    const int n_angles = 2 * this->n_angle_steps + 1;
+
+    // Prior on the correction from 3 standard deviations of the motion model uncertainty
+    this->prior_linear = max(3 * sqrt(R(0) * R(0) + R(1) * R(1)) * scale_x, 1.0f);
+    this->prior_angular = max(3 * R(2), this->angle_step);
+
+    // Linear window and number of pyramid levels so that the coarsest level covers the window in few steps
+    this->window_px = (int) ceil(this->linear_window * scale_x);
+    int n_levels = 1;
+    while ((1 << (n_levels - 1)) < this->window_px && n_levels < 7) {
+        n_levels++; }
+
+    // Beam endpoints in the map for all headings, track their bounding box
+    this->endpoints.resize((size_t) n_angles * this->n_hits);
+    const float x_map = (pose(0) - Map::getXMin()) * scale_x;
+    const float y_map = (pose(1) - Map::getYMin()) * scale_y;
+    int x_low = map.getCols(), y_low = map.getRows(), x_high = 0, y_high = 0;
+    for (int angle_id = 0; angle_id < n_angles; angle_id++) {
+        const float angle = pose(2) + (angle_id - this->n_angle_steps) * this->angle_step;
+        const float cos_t = cos(angle);
+        const float sin_t = sin(angle);
+        for (int hit_id = 0; hit_id < this->n_hits; hit_id++) {
+            const Eigen::Vector2f& hit = this->hits[hit_id];
+            Eigen::Vector2i& endpoint = this->endpoints[(size_t) angle_id * this->n_hits + hit_id];
+            endpoint(0) = (int) floor(x_map + (cos_t * hit(0) - sin_t * hit(1)) * scale_x);
+            endpoint(1) = (int) floor(y_map + (sin_t * hit(0) + cos_t * hit(1)) * scale_y);
+            x_low = min(x_low, endpoint(0));
+            y_low = min(y_low, endpoint(1));
+            x_high = max(x_high, endpoint(0));
+            y_high = max(y_high, endpoint(1));
+        }
+    }
+
+    // Crop the region reachable by the endpoints within the search window
+    this->crop_x = x_low - this->window_px;
+    this->crop_y = y_low - this->window_px;
+    this->crop_width = x_high - x_low + 2 * this->window_px + 1;
+    this->crop_height = y_high - y_low + 2 * this->window_px + 1;
+    for (vector<Eigen::Vector2i>::iterator it = this->endpoints.begin(); it != this->endpoints.end(); it++) {
+        (*it)(0) -= this->crop_x;
+        (*it)(1) -= this->crop_y;
+    }
+
+    // Evidence of occupancy, free and unknown cells do not contribute. Stored behind the pyramid levels.
+    const size_t level_size = (size_t) this->crop_width * this->crop_height;
+    this->pyramid.resize(level_size * (n_levels + 1));
+    float* evidence = this->pyramid.data() + n_levels * level_size;
+    const float evidence_range = (float) (Map::getThreshold() - Map::getValueMin());
+    for (int y = 0; y < this->crop_height; y++) {
+        const int y_px = y + this->crop_y;
+        float* row = evidence + (size_t) y * this->crop_width;
+        for (int x = 0; x < this->crop_width; x++) {
+            const int x_px = x + this->crop_x;
+            row[x] = 0;
+            if (x_px >= 0 && y_px >= 0 && x_px < map.getCols() && y_px < map.getRows()) {
+                row[x] = max(0, Map::getThreshold() - (int) map.getValue(x_px, y_px)) / evidence_range; }
+        }
+    }
+
+    // Finest level: maximum evidence of the 3 x 3 neighborhood, so that beams hitting a wall next to a mapped
+    // cell of it still count (walls are often mapped with gaps)
+    for (int y = 0; y < this->crop_height; y++) {
+        for (int x = 0; x < this->crop_width; x++) {
+            float value = 0;
+            for (int y_n = max(y - 1, 0); y_n <= min(y + 1, this->crop_height - 1); y_n++) {
+                for (int x_n = max(x - 1, 0); x_n <= min(x + 1, this->crop_width - 1); x_n++) {
+                    value = max(value, evidence[y_n * this->crop_width + x_n]); }
+            }
+            this->pyramid[y * this->crop_width + x] = value;
+        }
+    }
+
+    // Coarser levels: maximum over the 2^level x 2^level cells starting at each cell
+    for (int level = 1; level < n_levels; level++) {
+        const int shift = 1 << (level - 1);
+        const float* finer = this->pyramid.data() + (level - 1) * level_size;
+        float* coarser = this->pyramid.data() + level * level_size;
+        for (int y = 0; y < this->crop_height; y++) {
+            for (int x = 0; x < this->crop_width; x++) {
+                float value = finer[y * this->crop_width + x];
+                if (x + shift < this->crop_width) {
+                    value = max(value, finer[y * this->crop_width + x + shift]); }
+                if (y + shift < this->crop_height) {
+                    value = max(value, finer[(y + shift) * this->crop_width + x]); }
+                if (x + shift < this->crop_width && y + shift < this->crop_height) {
+                    value = max(value, finer[(y + shift) * this->crop_width + x + shift]); }
+                coarser[y * this->crop_width + x] = value;
+            }
+        }
+    }
+
+    // The unmodified pose is the initial best, other poses have to score strictly higher
+    MatchCandidate best = {0, 0, this->n_angle_steps, 0};
+    best.score = this->score(best, 0);
+    this->n_iterations++;
+
+    // Candidates of the coarsest level cover the window in steps of 2^(n_levels-1) cells
+    const int top_level = n_levels - 1;
+    const int top_step = 1 << top_level;
+    this->candidates.clear();
+    for (int angle_id = 0; angle_id < n_angles; angle_id++) {
+        for (int x_offset = -this->window_px; x_offset <= this->window_px; x_offset += top_step) {
+            for (int y_offset = -this->window_px; y_offset <= this->window_px; y_offset += top_step) {
+                MatchCandidate candidate = {x_offset, y_offset, angle_id, 0};
+                candidate.score = this->score(candidate, top_level);
+                this->candidates.push_back(candidate);
+            }
+        }
+    }
+    this->n_iterations += (long) this->candidates.size();
+    sort(this->candidates.begin(), this->candidates.end(), [](const MatchCandidate& a, const MatchCandidate& b){ return a.score > b.score; });
+
+    // Refine promising candidates down to full resolution
+    this->branch(top_level, this->candidates.data(), (int) this->candidates.size(), best);
+
+    // Convert best pose to a correction in world coordinates
+    if (best.score > 0) {
+        pose_dif(0) = best.x_offset / scale_x;
+        pose_dif(1) = best.y_offset / scale_y;
+        pose_dif(2) = (best.angle_id - this->n_angle_steps) * this->angle_step;
+    }
+
+    return pose_dif;
+}
+
+#endif /* CorrelativeMatcher_h */
@@ -0,0 +1,47 @@
+//
+//  GridMatcher.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 02.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+
+#include "GridMatcher.h"
+
+using namespace std;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Standard constructor
+GridMatcher::GridMatcher(){
+    
+    this->max_iterations = 20;
+    this->tolerance = 0.001;
+    this->n_iterations = 0;
+}
+
+
+// Constructor
+GridMatcher::GridMatcher(int max_iterations, float tolerance): max_iterations(max_iterations), tolerance(tolerance) {
+    
+    this->n_iterations = 0;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void GridMatcher::summary(){
+    
+    cout << "Grid Matcher: " << endl;
+    cout << "------------" << endl;
+    cout << "Max Iterations: " << this->max_iterations << endl;
+    cout << "Tolerance: " << this->tolerance << endl;
+
+}
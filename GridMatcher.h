@@ -0,0 +1,162 @@
+//
+//  GridMatcher.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 02.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef GridMatcher_h
+#define GridMatcher_h
+
+#include <math.h>
+#include <Eigen/Dense>
+
+#include "Map.h"
+
+using namespace std;
+
+
+// Scan-to-map matcher (Hector SLAM style). The endpoints of the measured beams are aligned directly to the
+// occupancy grid by Gauss-Newton minimization of 1 - M(S(pose)), where M is the bilinear interpolation of the
+// occupancy probability and S transforms a beam endpoint to the map. No estimated scan is required.
+class GridMatcher {
+
+    public:
+        // Constructor and destructor
+        GridMatcher();
+        GridMatcher(int max_iterations, float tolerance);
+        ~GridMatcher(){};
+
+        // Print grid matcher summary
+        void summary();
+
+        // Compute pose correction aligning the measurements (angle, range) taken at pose to the grid. Grid is
+        // any type providing getValue(x_px, y_px), getRows() and getCols().
+        template<typename Grid>
+        Eigen::Vector3f match(const Grid& map, const Eigen::Vector3f& pose, const Eigen::MatrixX2f& measurements,
+                              const float& range, const Eigen::Vector3f R);
+
+        // Number of Gauss-Newton iterations since the last reset
+        const long& getNIterations(){ return this->n_iterations; };
+        void resetNIterations(){ this->n_iterations = 0; };
+
+    private:
+        // Occupancy probability at continuous map coordinates and its gradient in map coordinates. Returns
+        // false if the interpolation support is outside the grid.
+        template<typename Grid>
+        static bool interpolate(const Grid& map, const float& x_map, const float& y_map, float& occupancy,
+                                Eigen::Vector2f& gradient);
+
+        int max_iterations;
+        float tolerance; // minimum pose update in m and rad to continue iterating
+        long n_iterations; // number of iterations since the last reset
+
+};
+
+
+// Bilinear interpolation of the occupancy probability between the mass centers of the four surrounding cells
+template<typename Grid>
+bool GridMatcher::interpolate(const Grid& map, const float& x_map, const float& y_map, float& occupancy,
+                              Eigen::Vector2f& gradient){
+
+    // Lower left cell of the interpolation support, cell (i, j) has its mass center at (i + 0.5, j + 0.5)
+    const float x = x_map - 0.5f;
+    const float y = y_map - 0.5f;
+    const int x_px = (int) floor(x);
+    const int y_px = (int) floor(y);
+    if (x_px < 0 || y_px < 0 || x_px + 1 >= map.getCols() || y_px + 1 >= map.getRows()) {
+        return false; }
+
+    // Occupancy probabilities of the support cells (low cell values are occupied)
+    const float value_range = (float) (Map::getValueMax() - Map::getValueMin());
+    const float m_00 = (Map::getValueMax() - map.getValue(x_px, y_px)) / value_range;
+    const float m_10 = (Map::getValueMax() - map.getValue(x_px + 1, y_px)) / value_range;
+    const float m_01 = (Map::getValueMax() - map.getValue(x_px, y_px + 1)) / value_range;
+    const float m_11 = (Map::getValueMax() - map.getValue(x_px + 1, y_px + 1)) / value_range;
+
+    // Interpolate value and gradient
+    const float f_x = x - x_px;
+    const float f_y = y - y_px;
+    occupancy = (1 - f_y) * ((1 - f_x) * m_00 + f_x * m_10) + f_y * ((1 - f_x) * m_01 + f_x * m_11);
+    gradient(0) = (1 - f_y) * (m_10 - m_00) + f_y * (m_11 - m_01);
+    gradient(1) = (1 - f_x) * (m_01 - m_00) + f_x * (m_11 - m_10);
+
+    return true;
+}
+
+
+// Gauss-Newton alignment of the beam endpoints to the grid
+template<typename Grid>
+Eigen::Vector3f GridMatcher::match(const Grid& map, const Eigen::Vector3f& pose, const Eigen::MatrixX2f& measurements,
+                                   const float& range, const Eigen::Vector3f R){
+
+    // Scale from world coordinates to continuous map coordinates
+    const float scale_x = Map::getWidth() / Map::getResolution() / (Map::getXMax() - Map::getXMin());
+    const float scale_y = Map::getHeight() / Map::getResolution() / (Map::getYMax() - Map::getYMin());
+
+    // Pose estimate, refined in every iteration
+    Eigen::Vector3f estimate = pose;
+
+    for (int iter = 0; iter < this->max_iterations; iter++) {
+
+        this->n_iterations++;
+
+        const float cos_t = cos((float) estimate(2));
+        const float sin_t = sin((float) estimate(2));
+
+        // Accumulate normal equations over all beams that hit an obstacle
+        Eigen::Matrix3f H = Eigen::Matrix3f::Zero();
+        Eigen::Vector3f b = Eigen::Vector3f::Zero();
+        for (int beam_id = 0; beam_id < measurements.rows(); beam_id++) {
+
+            if (measurements(beam_id, 1) >= range) {
+                continue; }
+
+            // Beam endpoint in the sensor frame and in the map
+            const float x_l = measurements(beam_id, 1) * cos(measurements(beam_id, 0));
+            const float y_l = measurements(beam_id, 1) * sin(measurements(beam_id, 0));
+            const float x_w = estimate(0) + cos_t * x_l - sin_t * y_l;
+            const float y_w = estimate(1) + sin_t * x_l + cos_t * y_l;
+
+            float occupancy;
+            Eigen::Vector2f gradient;
+            if (!GridMatcher::interpolate(map, (x_w - Map::getXMin()) * scale_x, (y_w - Map::getYMin()) * scale_y, occupancy, gradient)) {
+                continue; }
+
+            // Jacobian of the occupancy at the endpoint w.r.t. the pose (gradient in world coordinates)
+            const float g_x = gradient(0) * scale_x;
+            const float g_y = gradient(1) * scale_y;
+            Eigen::Vector3f J;
+            J(0) = g_x;
+            J(1) = g_y;
+            J(2) = g_x * (-sin_t * x_l - cos_t * y_l) + g_y * (cos_t * x_l - sin_t * y_l);
+
+            H += J * J.transpose();
+            b += J * (1.0f - occupancy);
+        }
+
+        // Stop if the grid does not constrain the pose (e.g. unexplored map)
+        if (abs(H.determinant()) < 1e-6) {
+            break; }
+
+        // Apply pose update
+        const Eigen::Vector3f delta = H.ldlt().solve(b);
+        estimate += delta;
+
+        if (delta.head<2>().norm() < this->tolerance && abs(delta(2)) < this->tolerance) {
+            break; }
+    }
+
+    // Only apply pose correction if correction distance smaller than radius of 3 standard deviations of
+    // motion model uncertainty
+    Eigen::Vector3f pose_dif = Eigen::Vector3f::Zero();
+    const Eigen::Vector3f correction = estimate - pose;
+    if (correction.head<2>().norm() < sqrt(pow(3 * R(0), 2) + pow(3 * R(1), 2))) {
+        pose_dif = correction;
+    }
+
+    return pose_dif;
+}
+
+#endif /* GridMatcher_h */
@@ -0,0 +1,106 @@
+//
+//  KDTree2D.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 30.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "KDTree2D.h"
+
+using namespace std;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++ Build Tree ++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void KDTree2D::build(const Eigen::Ref<const Eigen::MatrixX2f>& points){
+
+    const int n_points = (int) points.rows();
+
+    // Start with points in their original order
+    this->indices.resize(n_points);
+    iota(this->indices.begin(), this->indices.end(), 0);
+    this->x_coordinates.resize(n_points);
+    this->y_coordinates.resize(n_points);
+    for (int point_id = 0; point_id < n_points; point_id++) {
+        this->x_coordinates[point_id] = points(point_id, 0);
+        this->y_coordinates[point_id] = points(point_id, 1);
+    }
+
+    // Sort points into tree order
+    this->build_range(0, n_points, 0);
+
+    // Store coordinates in tree order for cache-friendly queries
+    for (int node_id = 0; node_id < n_points; node_id++) {
+        this->x_coordinates[node_id] = points(this->indices[node_id], 0);
+        this->y_coordinates[node_id] = points(this->indices[node_id], 1);
+    }
+}
+
+
+void KDTree2D::build_range(const int& start, const int& end, const int& depth){
+
+    if (end - start <= 1) {
+        return; }
+
+    // Place median along the split axis at the center of the range
+    const int median = (start + end) / 2;
+    const vector<float>& coordinates = (depth % 2 == 0) ? this->x_coordinates : this->y_coordinates;
+    nth_element(this->indices.begin() + start, this->indices.begin() + median, this->indices.begin() + end,
+                [&](const int& a, const int& b){ return coordinates[a] < coordinates[b]; });
+
+    // Build subtrees
+    this->build_range(start, median, depth + 1);
+    this->build_range(median + 1, end, depth + 1);
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Nearest Neighbor +++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+int KDTree2D::nearest(const float& x, const float& y, float& squared_distance) const {
+
+    int best_id = -1;
+    squared_distance = numeric_limits<float>::max();
+    this->search_range(0, (int) this->indices.size(), 0, x, y, best_id, squared_distance);
+    return best_id;
+}
+
+
+void KDTree2D::search_range(const int& start, const int& end, const int& depth, const float& x, const float& y,
+                            int& best_id, float& best_distance) const {
+
+    if (end <= start) {
+        return; }
+
+    // Check node at the median of the range
+    const int median = (start + end) / 2;
+    const float dx = x - this->x_coordinates[median];
+    const float dy = y - this->y_coordinates[median];
+    const float distance = dx * dx + dy * dy;
+    const int point_id = this->indices[median];
+    if (distance < best_distance || (distance == best_distance && point_id < best_id)) {
+        best_distance = distance;
+        best_id = point_id;
+    }
+
+    // Search subtree on the side of the query point first
+    const float axis_distance = (depth % 2 == 0) ? dx : dy;
+    if (axis_distance < 0) {
+        this->search_range(start, median, depth + 1, x, y, best_id, best_distance);
+        if (axis_distance * axis_distance <= best_distance) {
+            this->search_range(median + 1, end, depth + 1, x, y, best_id, best_distance); }
+    }
+    else {
+        this->search_range(median + 1, end, depth + 1, x, y, best_id, best_distance);
+        if (axis_distance * axis_distance <= best_distance) {
+            this->search_range(start, median, depth + 1, x, y, best_id, best_distance); }
+    }
+}
@@ -0,0 +1,51 @@
+//
+//  KDTree2D.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 30.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef KDTree2D_h
+#define KDTree2D_h
+
+#include <vector>
+#include <Eigen/Dense>
+
+using namespace std;
+
+
+// Balanced k-d tree over a 2D point cloud for nearest neighbor queries in O(log M). The tree is stored
+// implicitly: the median of each range of points is the node, the lower and upper halves are its subtrees.
+class KDTree2D {
+
+    public:
+        // Constructor and destructor
+        KDTree2D(){};
+        ~KDTree2D(){};
+
+        // Build tree over the rows of a point cloud, buffers are reused across builds
+        void build(const Eigen::Ref<const Eigen::MatrixX2f>& points);
+
+        // Get index of the point closest to the query point and its squared distance. Among points with equal
+        // distance the one with the lowest index is returned.
+        int nearest(const float& x, const float& y, float& squared_distance) const;
+
+        // Number of points in the tree
+        int size() const { return (int) this->indices.size(); };
+
+    private:
+        // Sort points of range [start, end) around its median along the axis of the given depth
+        void build_range(const int& start, const int& end, const int& depth);
+
+        // Search range [start, end) for a point closer than the current best
+        void search_range(const int& start, const int& end, const int& depth, const float& x, const float& y,
+                          int& best_id, float& best_distance) const;
+
+        vector<int> indices; // indices of the points in tree order
+        vector<float> x_coordinates; // x coordinates in tree order
+        vector<float> y_coordinates; // y coordinates in tree order
+
+};
+
+#endif /* KDTree2D_h */
@@ -0,0 +1,96 @@
+//
+//  LikelihoodField.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 04.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include "LikelihoodField.h"
+
+using namespace std;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Empty field, resized to the grid on the first update
+LikelihoodField::LikelihoodField(){
+    
+    this->rows = 0;
+    this->cols = 0;
+    this->n_tiles_x = 0;
+    this->n_tiles_y = 0;
+}
+
+
+// Resize field to the dimensions of a grid
+void LikelihoodField::resize(const int& rows, const int& cols){
+    
+    this->rows = rows;
+    this->cols = cols;
+    this->n_tiles_x = (this->cols + Map::getTileSize() - 1) / Map::getTileSize();
+    this->n_tiles_y = (this->rows + Map::getTileSize() - 1) / Map::getTileSize();
+    
+    // All tiles share one tile at maximum distance until they are written to
+    shared_ptr<Tile> far_tile = make_shared<Tile>(Map::getTileSize() * Map::getTileSize(), (uchar) (LikelihoodField::max_distance * LikelihoodField::distance_scale));
+    this->tiles = vector<shared_ptr<Tile>>(this->n_tiles_x * this->n_tiles_y, far_tile);
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++ Tile Access +++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+uchar* LikelihoodField::getWritableTileData(const int& tile_x, const int& tile_y){
+    
+    shared_ptr<Tile>& tile = this->tiles[tile_y * this->n_tiles_x + tile_x];
+    
+    if (tile.use_count() > 1) {
+        tile = make_shared<Tile>(*tile);
+    }
+    else {
+        // Synchronize with the release of the last other reference before writing
+        atomic_thread_fence(memory_order_acquire);
+    }
+    
+    return tile->data();
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++ Distance Transform ++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// One-dimensional squared euclidean distance transform d(q) = min_p (q - p)^2 + f(p) as lower envelope of
+// parabolas. v holds the locations of the parabolas of the envelope, z the boundaries between them.
+void LikelihoodField::distance_transform(const float* f, const int& n, float* d, int* v, float* z){
+    
+    const float infinity = 1e30f;
+    
+    // Compute lower envelope
+    int k = 0;
+    v[0] = 0;
+    z[0] = -infinity;
+    z[1] = infinity;
+    for (int q = 1; q < n; q++) {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        while (s <= z[k]) {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = infinity;
+    }
+    
+    // Evaluate lower envelope
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) {
+            k++; }
+        d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
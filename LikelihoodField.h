@@ -0,0 +1,157 @@
+//
+//  LikelihoodField.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 04.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef LikelihoodField_h
+#define LikelihoodField_h
+
+#include <math.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "Map.h"
+
+using namespace std;
+
+
+// Distance from each grid cell to the nearest occupied cell of a map, used by the likelihood field measurement
+// model. Distances are clipped at max_distance cells and stored quantized in tiles of the same layout as the
+// tiles of a Map. Tiles are shared between copies of a field and cloned when a shared tile is written to.
+class LikelihoodField {
+
+    public:
+        // Constructor and destructor
+        LikelihoodField();
+        ~LikelihoodField(){};
+
+        // Copying a field shares its tiles, moving a field transfers them
+        LikelihoodField(const LikelihoodField& field) = default;
+        LikelihoodField(LikelihoodField&& field) = default;
+        LikelihoodField& operator=(const LikelihoodField& field) = default;
+        LikelihoodField& operator=(LikelihoodField&& field) = default;
+
+        // Recompute distances of all cells in range [x_start, x_end] x [y_start, y_end] after the occupancy of
+        // the map changed within this range. Grid is any type providing getValue(x_px, y_px), getRows() and
+        // getCols(). The field is resized to the grid if necessary.
+        template<typename Grid>
+        void update(const Grid& map, int x_start, int y_start, int x_end, int y_end);
+
+        // Distance of a grid cell to the nearest occupied cell in cells
+        float getDistance(const int& x_px, const int& y_px) const {
+            const Tile& tile = *this->tiles[(y_px >> Map::getTileBits()) * this->n_tiles_x + (x_px >> Map::getTileBits())];
+            return tile[((y_px & (Map::getTileSize()-1)) << Map::getTileBits()) + (x_px & (Map::getTileSize()-1))] / (float) LikelihoodField::distance_scale;
+        };
+
+        // Getter functions
+        const int& getRows() const { return this->rows; };
+        const int& getCols() const { return this->cols; };
+        static int getMaxDistance(){ return LikelihoodField::max_distance; };
+
+    private:
+        // Resize field to the dimensions of a grid, all distances are set to the maximum
+        void resize(const int& rows, const int& cols);
+
+        // Get writable pointer to the data of a tile, the tile is cloned first if it is shared with other fields
+        uchar* getWritableTileData(const int& tile_x, const int& tile_y);
+
+        // Squared euclidean distance transform of a sampled function (Felzenszwalb and Huttenlocher)
+        static void distance_transform(const float* f, const int& n, float* d, int* v, float* z);
+
+        // Clipping distance in cells and quantization steps per cell (max_distance * distance_scale <= 255)
+        static const int max_distance = 16;
+        static const int distance_scale = 15;
+
+        int rows; // height of the grid in px
+        int cols; // width of the grid in px
+        int n_tiles_x; // number of tiles per row
+        int n_tiles_y; // number of tiles per column
+        vector<shared_ptr<Tile>> tiles; // tiles of the field, possibly shared with other fields
+
+};
+
+
+// Recompute distances within a range of the grid
+template<typename Grid>
+void LikelihoodField::update(const Grid& map, int x_start, int y_start, int x_end, int y_end){
+
+    if (this->rows != map.getRows() || this->cols != map.getCols()) {
+        this->resize(map.getRows(), map.getCols()); }
+
+    // Limit range to the grid
+    x_start = max(x_start, 0);
+    y_start = max(y_start, 0);
+    x_end = min(x_end, this->cols - 1);
+    y_end = min(y_end, this->rows - 1);
+    if (x_start > x_end || y_start > y_end) {
+        return; }
+
+    // Distances change up to max_distance cells around the updated range and depend on occupied cells up to
+    // max_distance cells further out
+    const int write_x_start = max(x_start - max_distance, 0);
+    const int write_y_start = max(y_start - max_distance, 0);
+    const int write_x_end = min(x_end + max_distance, this->cols - 1);
+    const int write_y_end = min(y_end + max_distance, this->rows - 1);
+    const int source_x_start = max(write_x_start - max_distance, 0);
+    const int source_y_start = max(write_y_start - max_distance, 0);
+    const int width = min(write_x_end + max_distance, this->cols - 1) - source_x_start + 1;
+    const int height = min(write_y_end + max_distance, this->rows - 1) - source_y_start + 1;
+
+    // Per-thread scratch buffers, reused across updates
+    thread_local vector<float> squared_distances;
+    thread_local vector<float> f, d, z;
+    thread_local vector<int> v;
+    squared_distances.resize((size_t) width * height);
+    const int n = max(width, height);
+    f.resize(n);
+    d.resize(n);
+    z.resize(n + 1);
+    v.resize(n);
+
+    // Occupied cells have distance 0, all others are far away
+    const float infinity = 1e20f;
+    const int threshold = Map::getThreshold();
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            squared_distances[(size_t) y * width + x] = (map.getValue(source_x_start + x, source_y_start + y) < threshold) ? 0 : infinity;
+        }
+    }
+
+    // Transform columns, then rows
+    for (int x = 0; x < width; x++) {
+        for (int y = 0; y < height; y++) {
+            f[y] = squared_distances[(size_t) y * width + x]; }
+        LikelihoodField::distance_transform(f.data(), height, d.data(), v.data(), z.data());
+        for (int y = 0; y < height; y++) {
+            squared_distances[(size_t) y * width + x] = d[y]; }
+    }
+    for (int y = 0; y < height; y++) {
+        float* row = squared_distances.data() + (size_t) y * width;
+        LikelihoodField::distance_transform(row, width, d.data(), v.data(), z.data());
+        copy(d.begin(), d.begin() + width, row);
+    }
+
+    // Write clipped and quantized distances tile by tile
+    const int tile_size = Map::getTileSize();
+    const int tile_bits = Map::getTileBits();
+    for (int tile_y = (write_y_start >> tile_bits); tile_y <= (write_y_end >> tile_bits); tile_y++) {
+        for (int tile_x = (write_x_start >> tile_bits); tile_x <= (write_x_end >> tile_bits); tile_x++) {
+
+            uchar* tile_ptr = this->getWritableTileData(tile_x, tile_y);
+            for (int y_px = max(write_y_start, tile_y * tile_size); y_px <= min(write_y_end, (tile_y + 1) * tile_size - 1); y_px++) {
+                const float* row = squared_distances.data() + (size_t) (y_px - source_y_start) * width;
+                uchar* tile_row = tile_ptr + (y_px - tile_y * tile_size) * tile_size;
+                for (int x_px = max(write_x_start, tile_x * tile_size); x_px <= min(write_x_end, (tile_x + 1) * tile_size - 1); x_px++) {
+                    const float distance = min(sqrt(row[x_px - source_x_start]), (float) max_distance);
+                    tile_row[x_px - tile_x * tile_size] = (uchar) (distance * distance_scale + 0.5f);
+                }
+            }
+        }
+    }
+}
+
+#endif /* LikelihoodField_h */
@@ -8,12 +8,14 @@
 
 #include <stdio.h>
 #include <iostream>
+#include <string.h>
 #include <Eigen/Dense>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/eigen.hpp>
 
 #include "eigen2cv.h"
 #include "Map.h"
+#include "Tracer.h"
 
 using namespace std;
 
@@ -36,6 +38,11 @@ int Map::occupancy_value_max = 255;
 int Map::occupancy_value_step = 25;
 int Map::occupancy_threshold = 127;
 
+int Map::parameter_version = 0;
+
+cv::Mat Map::display_data;
+vector<weak_ptr<Tile>> Map::displayed_tiles;
+
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -45,7 +52,21 @@ Map::Map(){
     
     // Initialize raw map if map_type is 0 (mapping or SLAM mode)
     if (Map::map_type == 0){
-        this->data = cv::Mat((int)width/resolution, (int)height/resolution, CV_8UC1, cv::Scalar::all(Map::occupancy_threshold));
+        this->rows = (int)width/resolution;
+        this->cols = (int)height/resolution;
+        this->n_tiles_x = (this->cols + Map::tile_size - 1) / Map::tile_size;
+        this->n_tiles_y = (this->rows + Map::tile_size - 1) / Map::tile_size;
+        
+        // All tiles share one blank tile until they are written to
+        shared_ptr<Tile> blank_tile = make_shared<Tile>(Map::tile_size * Map::tile_size, (uchar)Map::occupancy_threshold);
+        this->tiles = vector<shared_ptr<Tile>>(this->n_tiles_x * this->n_tiles_y, blank_tile);
+        
+        // Nothing written yet
+        this->dirty_tiles = vector<uchar>(this->n_tiles_x * this->n_tiles_y, 0);
+        this->dirty_x_start = this->cols;
+        this->dirty_y_start = this->rows;
+        this->dirty_x_end = -1;
+        this->dirty_y_end = -1;
     }
     // Use ground truth map if map_type is 1 (localization mode)
     else {
@@ -57,11 +78,12 @@ Map::Map(){
         }
         else {
             // Read-in ground truth map
-            this->data = cv::imread(gt_map_file_path, CV_8UC1);
+            cv::Mat gt_data = cv::imread(gt_map_file_path, CV_8UC1);
+            this->setData(gt_data);
             
             // Get width and height of ground truth map
-            int gt_height = this->data.size().height;
-            int gt_width = this->data.size().width;
+            int gt_height = gt_data.size().height;
+            int gt_width = gt_data.size().width;
             
             // Get specified width and height from simulation parameters
             int map_height = (int)height/resolution;
@@ -70,6 +92,7 @@ Map::Map(){
             // Change width and height to dimensions of ground truth in case of mismatch
             if (gt_width != map_width || gt_height != map_height){
                 Map::resolution = (Map::x_max - Map::x_min) / gt_width;
+                Map::parameter_version++;
                 cout << "Size of ground truth map doesn't match specified map dimension." << endl;
                 cout << "New map dimensions: " << endl;
                 cout << "Width: " << gt_width << "px | Height: " << gt_height << "px" << endl;
@@ -115,6 +138,7 @@ void Map::setParameters(float x_min, float x_max, float y_min, float y_max, floa
     Map::occupancy_value_max = occupancy_value_max;
     Map::occupancy_value_step = occpuancy_value_step;
     Map::occupancy_threshold = occupancy_threshold;
+    Map::parameter_version++;
     
     // Set required map type
     if (simulation_mode == 1 || simulation_mode == 2){
@@ -127,19 +151,215 @@ void Map::setParameters(float x_min, float x_max, float y_min, float y_max, floa
 }
 
 
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++++++ Tiles ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Compose a single image from all tiles
+cv::Mat Map::getData() const {
+    
+    cv::Mat data = cv::Mat(this->rows, this->cols, CV_8UC1);
+    
+    // Copy each row of the grid from the tiles it spans
+    for (int y_px = 0; y_px < this->rows; y_px++) {
+        uchar* row_ptr = data.ptr<uchar>(y_px);
+        const int tile_y = y_px >> Map::tile_bits;
+        const int tile_row = (y_px & (Map::tile_size-1)) << Map::tile_bits;
+        for (int tile_x = 0; tile_x < this->n_tiles_x; tile_x++) {
+            const int x_start = tile_x << Map::tile_bits;
+            const int n_cells = min(Map::tile_size, this->cols - x_start);
+            memcpy(row_ptr + x_start, this->getTileData(tile_x, tile_y) + tile_row, n_cells);
+        }
+    }
+    
+    return data;
+}
+
+
+// Split an image into tiles. The tiles are owned exclusively by this map.
+void Map::setData(const cv::Mat& new_data){
+    
+    this->rows = new_data.rows;
+    this->cols = new_data.cols;
+    this->n_tiles_x = (this->cols + Map::tile_size - 1) / Map::tile_size;
+    this->n_tiles_y = (this->rows + Map::tile_size - 1) / Map::tile_size;
+    
+    // Create new tiles, cells outside the image are padded with the occupancy threshold
+    this->tiles.clear();
+    for (int tile_id = 0; tile_id < this->n_tiles_x * this->n_tiles_y; tile_id++) {
+        this->tiles.push_back(make_shared<Tile>(Map::tile_size * Map::tile_size, (uchar)Map::occupancy_threshold));
+    }
+    
+    // Copy each row of the image into the tiles it spans
+    for (int y_px = 0; y_px < this->rows; y_px++) {
+        const uchar* row_ptr = new_data.ptr<uchar>(y_px);
+        const int tile_y = y_px >> Map::tile_bits;
+        const int tile_row = (y_px & (Map::tile_size-1)) << Map::tile_bits;
+        for (int tile_x = 0; tile_x < this->n_tiles_x; tile_x++) {
+            const int x_start = tile_x << Map::tile_bits;
+            const int n_cells = min(Map::tile_size, this->cols - x_start);
+            memcpy(this->tiles[tile_y * this->n_tiles_x + tile_x]->data() + tile_row, row_ptr + x_start, n_cells);
+        }
+    }
+    
+    // All cells changed
+    this->dirty_tiles = vector<uchar>(this->n_tiles_x * this->n_tiles_y, 1);
+    this->dirty_x_start = 0;
+    this->dirty_y_start = 0;
+    this->dirty_x_end = this->cols - 1;
+    this->dirty_y_end = this->rows - 1;
+}
+
+
+// Get writable pointer to the data of a tile, clone the tile if it is shared with other maps.
+// Maps sharing a tile may be written from different threads. A map that clones a shared tile only drops its
+// reference after the copy is complete, so once the use count reads 1 the remaining owner may write in place.
+uchar* Map::getWritableTileData(const int& tile_x, const int& tile_y){
+    
+    shared_ptr<Tile>& tile = this->tiles[tile_y * this->n_tiles_x + tile_x];
+    
+    if (tile.use_count() > 1) {
+        tile = make_shared<Tile>(*tile);
+    }
+    else {
+        // Synchronize with the release of the last other reference before writing
+        atomic_thread_fence(memory_order_acquire);
+    }
+    
+    return tile->data();
+}
+
+
+// Number of tiles not shared with any other map
+int Map::getNUniqueTiles() const {
+    
+    int n_unique_tiles = 0;
+    for (vector<shared_ptr<Tile>>::const_iterator it = this->tiles.begin(); it != this->tiles.end(); it++) {
+        if ((*it).use_count() == 1) {
+            n_unique_tiles++;
+        }
+    }
+    return n_unique_tiles;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Dirty Region +++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Mark all cells in range [x_start, x_end] x [y_start, y_end] as dirty, the range is limited to the grid
+void Map::markDirty(int x_start, int y_start, int x_end, int y_end){
+    
+    x_start = max(x_start, 0);
+    y_start = max(y_start, 0);
+    x_end = min(x_end, this->cols - 1);
+    y_end = min(y_end, this->rows - 1);
+    if (x_start > x_end || y_start > y_end) {
+        return; }
+    
+    this->dirty_x_start = min(this->dirty_x_start, x_start);
+    this->dirty_y_start = min(this->dirty_y_start, y_start);
+    this->dirty_x_end = max(this->dirty_x_end, x_end);
+    this->dirty_y_end = max(this->dirty_y_end, y_end);
+    for (int tile_y = (y_start >> Map::tile_bits); tile_y <= (y_end >> Map::tile_bits); tile_y++) {
+        for (int tile_x = (x_start >> Map::tile_bits); tile_x <= (x_end >> Map::tile_bits); tile_x++) {
+            this->dirty_tiles[tile_y * this->n_tiles_x + tile_x] = 1;
+        }
+    }
+}
+
+
+// Clear dirty region. All dirty tiles lie within the bounding box, so only the tiles of the box are reset.
+void Map::clearDirty(){
+    
+    if (this->isDirty()) {
+        for (int tile_y = (this->dirty_y_start >> Map::tile_bits); tile_y <= (this->dirty_y_end >> Map::tile_bits); tile_y++) {
+            for (int tile_x = (this->dirty_x_start >> Map::tile_bits); tile_x <= (this->dirty_x_end >> Map::tile_bits); tile_x++) {
+                this->dirty_tiles[tile_y * this->n_tiles_x + tile_x] = 0;
+            }
+        }
+    }
+    
+    this->dirty_x_start = this->cols;
+    this->dirty_y_start = this->rows;
+    this->dirty_x_end = -1;
+    this->dirty_y_end = -1;
+}
+
+
+// Get bounding box of the dirty region, returns false if no cell is dirty
+bool Map::getDirtyRegion(int& x_start, int& y_start, int& x_end, int& y_end) const {
+    
+    x_start = this->dirty_x_start;
+    y_start = this->dirty_y_start;
+    x_end = this->dirty_x_end;
+    y_end = this->dirty_y_end;
+    return this->isDirty();
+}
+
+
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // +++++++++++++++++++++++++++++++++++++++++++++ Draw Map ++++++++++++++++++++++++++++++++++++++++++++++++++++
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+// Display map. The displayed image is kept between calls and only tiles that were written in the last mapping
+// step or that differ from the tiles of the last drawn map (e.g. after the best particle changed) are copied.
+// Tiles are compared by ownership, weak references keep a replaced tile from being mistaken for a new one. A tile
+// is only written in place while no other map shares it, so this relies on the map being drawn after every
+// mapping step.
 void Map::draw(){
     
+    TRACE_SCOPE("draw_map");
+    
+    // Start a new image if the grid dimensions changed
+    if (Map::display_data.rows != this->rows || Map::display_data.cols != this->cols) {
+        Map::display_data = cv::Mat(this->rows, this->cols, CV_8UC1);
+        Map::displayed_tiles = vector<weak_ptr<Tile>>(this->tiles.size());
+    }
+    
+    for (int tile_y = 0; tile_y < this->n_tiles_y; tile_y++) {
+        for (int tile_x = 0; tile_x < this->n_tiles_x; tile_x++) {
+            
+            const int tile_id = tile_y * this->n_tiles_x + tile_x;
+            const shared_ptr<Tile>& tile = this->tiles[tile_id];
+            weak_ptr<Tile>& displayed_tile = Map::displayed_tiles[tile_id];
+            if (this->dirty_tiles[tile_id] == 0 && !displayed_tile.owner_before(tile) && !tile.owner_before(displayed_tile)) {
+                continue; }
+            
+            // Copy rows of the tile within the grid
+            const int x_start = tile_x << Map::tile_bits;
+            const int y_start = tile_y << Map::tile_bits;
+            const int n_cells = min(Map::tile_size, this->cols - x_start);
+            for (int y_px = y_start; y_px < min(y_start + Map::tile_size, this->rows); y_px++) {
+                memcpy(Map::display_data.ptr<uchar>(y_px) + x_start, tile->data() + ((y_px - y_start) << Map::tile_bits), n_cells);
+            }
+            displayed_tile = tile;
+        }
+    }
+    
     cv::namedWindow("Map", cv::WINDOW_AUTOSIZE);
-    cv::imshow("Map", this->data);
+    cv::imshow("Map", Map::display_data);
     cv::waitKey(1);
         
 }
 
 
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Occupancy Update +++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Apply occupancy update to a cell value. Keep values within range of specified values in case maximum or
+// minimum is reached.
+uchar Map::updateValue(const uchar& value, const int& occupancy_update){
+    
+    if (value >= (Map::occupancy_value_max - Map::occupancy_value_step)) {
+        return (uchar) Map::occupancy_value_max; }
+    else if (value <= Map::occupancy_value_step) {
+        return (uchar) Map::occupancy_value_min; }
+    else { return (uchar) (value + occupancy_update); }
+}
+
+
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // +++++++++++++++++++++++++++++++++++++++ Coordinate Transforms +++++++++++++++++++++++++++++++++++++++++++++
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -9,12 +9,21 @@
 #ifndef Map_h
 #define Map_h
 
+#include <vector>
+#include <memory>
+#include <atomic>
 #include <Eigen/Dense>
 #include <opencv2/opencv.hpp>
 
 using namespace std;
 
+// Block of tile_size x tile_size grid cells stored row by row
+typedef vector<uchar> Tile;
 
+
+// Occupancy grid map. The grid is split into fixed-size tiles that are reference counted and shared between
+// copies of a map (e.g. particles duplicated during resampling). A tile is only cloned when a map sharing it
+// is about to write to it, so copying a map is cheap and memory grows with the area modified since the copy.
 class Map{
     
     public:
@@ -22,10 +31,17 @@ class Map{
         Map();
         ~Map(){};
     
+        // Copying a map shares its tiles, moving a map transfers them
+        Map(const Map& map) = default;
+        Map(Map&& map) = default;
+        Map& operator=(const Map& map) = default;
+        Map& operator=(Map&& map) = default;
+    
         // print summary of map
         static void summary();
     
-        // display map using cv::imshow
+        // display map using cv::imshow, only tiles that are dirty or differ from the last drawn map are copied to
+        // the displayed image
         void draw();
     
         // static getter functions
@@ -40,14 +56,72 @@ class Map{
         static const int& getValueMin(){ return Map::occupancy_value_min; };
         static const int& getValueStep(){ return Map::occupancy_value_step; };
         static const int& getThreshold(){ return Map::occupancy_threshold; };
+        static const int& getParameterVersion(){ return Map::parameter_version; };
     
         // static setter functions
         static void setParameters(float x_min, float x_max, float y_min, float y_max, float map_resolution, int occupancy_value_min, int occupancy_value_max, int occpuancy_value_step, int occupancy_threshold, int simulation_mode, string data_dir);
     
         // non-static getter functions
-        cv::Mat& getData(){ return this->data; };
-        cv::Mat getDataCopy(){ return this->data; };
-        void setData(cv::Mat new_data){this->data = new_data; }; 
+        const int& getRows() const { return this->rows; };
+        const int& getCols() const { return this->cols; };
+        static int getTileSize(){ return Map::tile_size; };
+        static int getTileBits(){ return Map::tile_bits; };
+        const int& getNTilesX() const { return this->n_tiles_x; };
+        const int& getNTilesY() const { return this->n_tiles_y; };
+    
+        // Compose a single image from all tiles / split an image into tiles
+        cv::Mat getData() const;
+        void setData(const cv::Mat& new_data);
+    
+        // Read value of a single grid cell
+        uchar getValue(const int& x_px, const int& y_px) const {
+            const Tile& tile = *this->tiles[(y_px >> Map::tile_bits) * this->n_tiles_x + (x_px >> Map::tile_bits)];
+            return tile[((y_px & (Map::tile_size-1)) << Map::tile_bits) + (x_px & (Map::tile_size-1))];
+        };
+    
+        // Get read-only or writable pointer to the data of a tile. Writable access clones the tile first if it
+        // is shared with other maps.
+        const uchar* getTileData(const int& tile_x, const int& tile_y) const { return this->tiles[tile_y * this->n_tiles_x + tile_x]->data(); };
+        uchar* getWritableTileData(const int& tile_x, const int& tile_y);
+    
+        // Apply occupancy update to a single grid cell
+        void update(const int& x_px, const int& y_px, const int& occupancy_update){
+            uchar* tile_ptr = this->getWritableTileData(x_px >> Map::tile_bits, y_px >> Map::tile_bits);
+            uchar& value = tile_ptr[((y_px & (Map::tile_size-1)) << Map::tile_bits) + (x_px & (Map::tile_size-1))];
+            value = Map::updateValue(value, occupancy_update);
+            this->markDirty(x_px, y_px);
+        };
+    
+        // Dirty region of the grid, i.e. the bounding box and tiles of all cells written since the region was last
+        // cleared. RBPF::mapping clears it before writing the observations of a step, so consumers can restrict
+        // their work to the cells changed in the last step. Copies of a map take over its dirty region.
+        void markDirty(const int& x_px, const int& y_px){
+            this->dirty_x_start = min(this->dirty_x_start, x_px);
+            this->dirty_y_start = min(this->dirty_y_start, y_px);
+            this->dirty_x_end = max(this->dirty_x_end, x_px);
+            this->dirty_y_end = max(this->dirty_y_end, y_px);
+            this->dirty_tiles[(y_px >> Map::tile_bits) * this->n_tiles_x + (x_px >> Map::tile_bits)] = 1;
+        };
+        void markDirty(int x_start, int y_start, int x_end, int y_end);
+        void clearDirty();
+        bool isDirty() const { return this->dirty_x_start <= this->dirty_x_end; };
+        bool isTileDirty(const int& tile_x, const int& tile_y) const { return this->dirty_tiles[tile_y * this->n_tiles_x + tile_x] != 0; };
+    
+        // Get bounding box of the dirty region, returns false if no cell is dirty
+        bool getDirtyRegion(int& x_start, int& y_start, int& x_end, int& y_end) const;
+    
+        // Number of tiles not shared with any other map
+        int getNUniqueTiles() const;
+    
+        // Check if a tile is shared with another map. Shared tiles are never written, so they hold the same data
+        // in both maps.
+        bool sharesTile(const Map& map, const int& tile_x, const int& tile_y) const {
+            const int tile_id = tile_y * this->n_tiles_x + tile_x;
+            return tile_id < (int) map.tiles.size() && this->tiles[tile_id] == map.tiles[tile_id];
+        };
+    
+        // apply occupancy update to a cell value, values close to the limits are clamped
+        static uchar updateValue(const uchar& value, const int& occupancy_update);
     
         // coordinate transform
         static Eigen::Array3f world2map(const Eigen::Array3f &world_pose);
@@ -71,14 +145,36 @@ class Map{
         static float y_max; // max y coordinate of map in m
         static float resolution; // resolution of the map in m/px
     
+        // static variables tiling, tiles hold 2^tile_bits x 2^tile_bits cells
+        static const int tile_bits = 6;
+        static const int tile_size = 1 << tile_bits;
+    
         // static variables grid mapping parameters
         static int occupancy_value_max;
         static int occupancy_value_min;
         static int occupancy_value_step;
         static int occupancy_threshold;
     
+        // static variable counting parameter changes, used to invalidate precomputed tables
+        static int parameter_version;
+    
+        // static variables display, image of the last drawn map and the tiles it was composed of
+        static cv::Mat display_data;
+        static vector<weak_ptr<Tile>> displayed_tiles;
+    
         // map data
-        cv::Mat data;
+        int rows; // height of the grid in px
+        int cols; // width of the grid in px
+        int n_tiles_x; // number of tiles per row
+        int n_tiles_y; // number of tiles per column
+        vector<shared_ptr<Tile>> tiles; // tiles of the grid, possibly shared with other maps
+    
+        // dirty region
+        int dirty_x_start; // bounding box of the written cells in px, empty if start > end
+        int dirty_y_start;
+        int dirty_x_end;
+        int dirty_y_end;
+        vector<uchar> dirty_tiles; // 1 for each tile containing a written cell
     
 };
 
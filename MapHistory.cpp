@@ -0,0 +1,358 @@
+//
+//  MapHistory.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 11.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+#include <string.h>
+
+#include "MapHistory.h"
+#include "Tracer.h"
+
+using namespace std;
+
+// Magic number and version of the file format
+static const char MAP_HISTORY_MAGIC[8] = {'F', 'S', 'L', 'A', 'M', 'M', 'A', 'P'};
+static const uint32_t MAP_HISTORY_VERSION = 1;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++++ PackBits +++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Run-length encoding of n bytes. Every packet starts with a header byte h: for h in [0, 127] h + 1 literal
+// bytes follow, for h in [129, 255] the following byte is repeated 257 - h times.
+static void packbits_encode(const uchar* data, const int& n, vector<uchar>& encoded){
+
+    encoded.clear();
+    int i = 0;
+    while (i < n) {
+
+        // Run of at least two equal bytes
+        int run = 1;
+        while (i + run < n && run < 128 && data[i + run] == data[i]) {
+            run++; }
+        if (run >= 2) {
+            encoded.push_back((uchar) (257 - run));
+            encoded.push_back(data[i]);
+            i += run;
+            continue;
+        }
+
+        // Literal bytes up to the next run
+        const int start = i;
+        while (i < n && i - start < 128 && !(i + 1 < n && data[i] == data[i + 1])) {
+            i++; }
+        encoded.push_back((uchar) (i - start - 1));
+        encoded.insert(encoded.end(), data + start, data + i);
+    }
+}
+
+// Decode exactly n bytes, returns false if the encoded data is corrupt
+static bool packbits_decode(const uchar* encoded, const int& size, uchar* data, const int& n){
+
+    int i = 0;
+    int j = 0;
+    while (i < size && j < n) {
+        const int h = encoded[i++];
+        if (h < 128) {
+            if (i + h + 1 > size || j + h + 1 > n) {
+                return false; }
+            memcpy(data + j, encoded + i, h + 1);
+            i += h + 1;
+            j += h + 1;
+        }
+        else if (h > 128) {
+            if (i >= size || j + 257 - h > n) {
+                return false; }
+            memset(data + j, encoded[i++], 257 - h);
+            j += 257 - h;
+        }
+    }
+    return i == size && j == n;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++ Map History Writer ++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Constructor, the header is written with the first frame
+MapHistoryWriter::MapHistoryWriter(const string& file_path, const int& keyframe_interval){
+
+    this->file_path = file_path;
+    this->file = fopen(file_path.c_str(), "wb");
+    if (this->file == nullptr) {
+        cout << "Unable to open map history " << file_path << " for writing!" << endl;
+        exit(1);
+    }
+    this->keyframe_interval = max(keyframe_interval, 1);
+    this->n_frames = 0;
+    this->n_tiles = 0;
+    this->n_bytes = 0;
+}
+
+// Destructor, closes the file if this did not happen yet
+MapHistoryWriter::~MapHistoryWriter(){
+    this->close();
+}
+
+// Append frame of a map
+void MapHistoryWriter::write(const int& step, const Map& map){
+
+    TRACE_SCOPE("write_map_history");
+
+    if (this->file == nullptr) {
+        cout << "Map history " << this->file_path << " is already closed!" << endl;
+        exit(1);
+    }
+
+    // Write header with the dimensions of the first map
+    if (this->n_frames == 0) {
+        MapHistoryHeader header;
+        memcpy(header.magic, MAP_HISTORY_MAGIC, sizeof(MAP_HISTORY_MAGIC));
+        header.version = MAP_HISTORY_VERSION;
+        header.rows = map.getRows();
+        header.cols = map.getCols();
+        header.tile_size = Map::getTileSize();
+        header.keyframe_interval = this->keyframe_interval;
+        fwrite(&header, sizeof(MapHistoryHeader), 1, this->file);
+        this->n_bytes += sizeof(MapHistoryHeader);
+    }
+    else if (map.getRows() != this->last_map->getRows() || map.getCols() != this->last_map->getCols()) {
+        cout << "Map dimensions changed while writing the map history!" << endl;
+        exit(1);
+    }
+
+    // Collect all tiles for keyframes, otherwise the tiles that differ from the previous frame
+    MapHistoryFrame frame;
+    frame.step = step;
+    frame.keyframe = (this->n_frames % this->keyframe_interval == 0) ? 1 : 0;
+    frame.n_tiles = 0;
+    this->payload.clear();
+    const int tile_bytes = Map::getTileSize() * Map::getTileSize();
+    for (int tile_y = 0; tile_y < map.getNTilesY(); tile_y++) {
+        for (int tile_x = 0; tile_x < map.getNTilesX(); tile_x++) {
+
+            const uchar* tile_data = map.getTileData(tile_x, tile_y);
+            if (frame.keyframe == 0 && (map.sharesTile(*this->last_map, tile_x, tile_y) ||
+                memcmp(tile_data, this->last_map->getTileData(tile_x, tile_y), tile_bytes) == 0)) {
+                continue; }
+
+            // Store tile raw if it does not compress
+            packbits_encode(tile_data, tile_bytes, this->compressed);
+            const bool raw = (int) this->compressed.size() >= tile_bytes;
+            const uint32_t entry[2] = {(uint32_t) (tile_y * map.getNTilesX() + tile_x), (uint32_t) (raw ? tile_bytes : this->compressed.size())};
+            const uchar* entry_ptr = (const uchar*) entry;
+            this->payload.insert(this->payload.end(), entry_ptr, entry_ptr + sizeof(entry));
+            if (raw) {
+                this->payload.insert(this->payload.end(), tile_data, tile_data + tile_bytes); }
+            else {
+                this->payload.insert(this->payload.end(), this->compressed.begin(), this->compressed.end()); }
+            frame.n_tiles++;
+        }
+    }
+    frame.payload_size = (uint32_t) this->payload.size();
+
+    fwrite(&frame, sizeof(MapHistoryFrame), 1, this->file);
+    fwrite(this->payload.data(), 1, this->payload.size(), this->file);
+    this->n_bytes += sizeof(MapHistoryFrame) + this->payload.size();
+    this->n_tiles += frame.n_tiles;
+    this->n_frames++;
+
+    // Keep map of this frame, copying shares its tiles
+    this->last_map.reset(new Map(map));
+}
+
+// Close history file
+void MapHistoryWriter::close(){
+
+    if (this->file == nullptr) {
+        return; }
+
+    fclose(this->file);
+    this->file = nullptr;
+    this->last_map.reset();
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++ Map History Reader ++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Constructor, validates the header and indexes all complete frames
+MapHistoryReader::MapHistoryReader(const string& file_path){
+
+    this->file_path = file_path;
+    this->file = fopen(file_path.c_str(), "rb");
+    if (this->file == nullptr) {
+        cout << "Unable to open map history " << file_path << "!" << endl;
+        exit(1);
+    }
+
+    if (fread(&this->header, sizeof(MapHistoryHeader), 1, this->file) != 1 ||
+        memcmp(this->header.magic, MAP_HISTORY_MAGIC, sizeof(MAP_HISTORY_MAGIC)) != 0) {
+        cout << file_path << " is not a map history!" << endl;
+        exit(1);
+    }
+    if (this->header.version != MAP_HISTORY_VERSION) {
+        cout << "Unsupported version " << this->header.version << " of map history " << file_path << "!" << endl;
+        exit(1);
+    }
+    this->n_tiles_x = (this->header.cols + this->header.tile_size - 1) / this->header.tile_size;
+    this->n_tiles_y = (this->header.rows + this->header.tile_size - 1) / this->header.tile_size;
+
+    // Index frames, a truncated last frame (e.g. of an interrupted simulation) is ignored
+    fseek(this->file, 0, SEEK_END);
+    const long file_size = ftell(this->file);
+    long offset = sizeof(MapHistoryHeader);
+    MapHistoryFrame frame;
+    while (fseek(this->file, offset, SEEK_SET) == 0 && fread(&frame, sizeof(MapHistoryFrame), 1, this->file) == 1) {
+        offset += sizeof(MapHistoryFrame);
+        if (offset + (long) frame.payload_size > file_size) {
+            break; }
+        FrameIndex index;
+        index.step = frame.step;
+        index.keyframe = frame.keyframe == 1;
+        index.n_tiles = frame.n_tiles;
+        index.offset = offset;
+        index.payload_size = frame.payload_size;
+        this->frames.push_back(index);
+        offset += frame.payload_size;
+    }
+    if (this->frames.empty() || !this->frames[0].keyframe) {
+        cout << "Map history " << file_path << " contains no frames!" << endl;
+        exit(1);
+    }
+
+    this->tiles = vector<vector<uchar>>(this->n_tiles_x * this->n_tiles_y, vector<uchar>(this->header.tile_size * this->header.tile_size));
+    this->current_frame = -1;
+}
+
+// Destructor, closes the file
+MapHistoryReader::~MapHistoryReader(){
+    fclose(this->file);
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void MapHistoryReader::summary(){
+
+    long n_tiles = 0;
+    for (vector<FrameIndex>::iterator it = this->frames.begin(); it != this->frames.end(); it++) {
+        n_tiles += (*it).n_tiles; }
+
+    cout << "Map History:" << endl;
+    cout << "------------" << endl;
+    cout << "File: " << this->file_path << endl;
+    cout << "Width: " << this->header.cols << "px | Height: " << this->header.rows << "px" << endl;
+    cout << "Frames: " << this->frames.size() << " (steps " << this->frames.front().step << " to " << this->frames.back().step << ")" << endl;
+    cout << "Keyframe Interval: " << this->header.keyframe_interval << endl;
+    cout << "Stored Tiles: " << n_tiles << " of " << (long) this->frames.size() * this->n_tiles_x * this->n_tiles_y << endl;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++ Reconstruction ++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Grid of a frame
+cv::Mat MapHistoryReader::read(const int& frame_id){
+
+    if (frame_id < 0 || frame_id >= (int) this->frames.size()) {
+        cout << "Frame " << frame_id << " not contained in map history " << this->file_path << "!" << endl;
+        exit(1);
+    }
+
+    // Start from the preceding keyframe unless the current grid can be brought forward
+    int keyframe_id = frame_id;
+    while (!this->frames[keyframe_id].keyframe) {
+        keyframe_id--; }
+    if (this->current_frame < keyframe_id || this->current_frame > frame_id) {
+        this->current_frame = keyframe_id - 1; }
+    while (this->current_frame < frame_id) {
+        this->apply_frame(++this->current_frame); }
+
+    // Compose image from the tiles
+    const int tile_size = this->header.tile_size;
+    cv::Mat data = cv::Mat(this->header.rows, this->header.cols, CV_8UC1);
+    for (int y_px = 0; y_px < this->header.rows; y_px++) {
+        uchar* row_ptr = data.ptr<uchar>(y_px);
+        const int tile_y = y_px / tile_size;
+        const int tile_row = (y_px % tile_size) * tile_size;
+        for (int tile_x = 0; tile_x < this->n_tiles_x; tile_x++) {
+            const int x_start = tile_x * tile_size;
+            const int n_cells = min(tile_size, this->header.cols - x_start);
+            memcpy(row_ptr + x_start, this->tiles[tile_y * this->n_tiles_x + tile_x].data() + tile_row, n_cells);
+        }
+    }
+
+    return data;
+}
+
+// Grid of the last frame at or before a simulation step
+cv::Mat MapHistoryReader::readStep(const int& step){
+
+    // Frames are ordered by step
+    int frame_id = -1;
+    int low = 0;
+    int high = (int) this->frames.size() - 1;
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+        if (this->frames[mid].step <= step) {
+            frame_id = mid;
+            low = mid + 1;
+        }
+        else {
+            high = mid - 1; }
+    }
+    if (frame_id < 0) {
+        cout << "No frame at or before step " << step << " in map history " << this->file_path << "!" << endl;
+        exit(1);
+    }
+
+    return this->read(frame_id);
+}
+
+// Apply tiles of a frame to the current grid
+void MapHistoryReader::apply_frame(const int& frame_id){
+
+    const FrameIndex& frame = this->frames[frame_id];
+    this->payload.resize(frame.payload_size);
+    fseek(this->file, frame.offset, SEEK_SET);
+    if (fread(this->payload.data(), 1, frame.payload_size, this->file) != frame.payload_size) {
+        cout << "Unable to read frame " << frame_id << " of map history " << this->file_path << "!" << endl;
+        exit(1);
+    }
+
+    const int tile_bytes = this->header.tile_size * this->header.tile_size;
+    size_t position = 0;
+    for (int entry_id = 0; entry_id < frame.n_tiles; entry_id++) {
+
+        uint32_t entry[2];
+        bool valid = position + sizeof(entry) <= this->payload.size();
+        if (valid) {
+            memcpy(entry, this->payload.data() + position, sizeof(entry));
+            position += sizeof(entry);
+            valid = entry[0] < this->tiles.size() && position + entry[1] <= this->payload.size();
+        }
+        if (valid) {
+            uchar* tile_data = this->tiles[entry[0]].data();
+            if ((int) entry[1] == tile_bytes) {
+                memcpy(tile_data, this->payload.data() + position, tile_bytes); }
+            else {
+                valid = packbits_decode(this->payload.data() + position, (int) entry[1], tile_data, tile_bytes); }
+            position += entry[1];
+        }
+        if (!valid) {
+            cout << "Frame " << frame_id << " of map history " << this->file_path << " is corrupt!" << endl;
+            exit(1);
+        }
+    }
+}
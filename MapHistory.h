@@ -0,0 +1,132 @@
+//
+//  MapHistory.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 11.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef MapHistory_h
+#define MapHistory_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+#include "Map.h"
+
+using namespace std;
+
+// Map history file. The file starts with a header describing the grid, followed by one frame per saved map.
+// Keyframes contain all tiles of the grid, the frames in between only the tiles that changed since the previous
+// frame. Tiles are compressed with PackBits run-length encoding, which suits the large uniform areas of
+// occupancy grids, or stored raw if they do not compress. Values are stored in native byte order.
+typedef struct {
+    char magic[8]; // "FSLAMMAP"
+    uint32_t version; // version of the file format
+    int32_t rows; // height of the grid in px
+    int32_t cols; // width of the grid in px
+    int32_t tile_size; // width and height of a tile in px
+    int32_t keyframe_interval; // number of frames from one keyframe to the next
+} MapHistoryHeader;
+
+// Header of a frame, followed by n_tiles entries of tile ID, size and data (payload_size bytes in total)
+typedef struct {
+    int32_t step; // simulation step of the map
+    int32_t keyframe; // 1 if the frame contains all tiles
+    int32_t n_tiles; // number of tiles in the frame
+    uint32_t payload_size; // size of the tile entries in bytes
+} MapHistoryFrame;
+
+
+// Appends maps to a history file, storing only the tiles that changed since the previous frame. Tiles a map
+// still shares with the previous frame are skipped without comparing their data.
+class MapHistoryWriter {
+
+    public:
+        // Constructor and destructor
+        MapHistoryWriter(const string& file_path, const int& keyframe_interval = 100);
+        ~MapHistoryWriter();
+
+        MapHistoryWriter(const MapHistoryWriter& writer) = delete;
+        MapHistoryWriter& operator=(const MapHistoryWriter& writer) = delete;
+
+        // Append frame of a map at a simulation step
+        void write(const int& step, const Map& map);
+
+        // Close history file
+        void close();
+
+        // Getter functions
+        const int& getNFrames(){ return this->n_frames; };
+        const long& getNTiles(){ return this->n_tiles; };
+        const long& getNBytes(){ return this->n_bytes; };
+
+    private:
+        FILE* file;
+        string file_path;
+        int keyframe_interval;
+        int n_frames; // number of written frames
+        long n_tiles; // number of written tiles
+        long n_bytes; // size of the file in bytes
+        unique_ptr<Map> last_map; // map of the previous frame, shares all tiles that did not change since
+        vector<uchar> payload; // tile entries of the current frame
+        vector<uchar> compressed; // compressed data of the current tile
+
+};
+
+
+// Reconstructs the grid of any frame of a map history. Frame headers are indexed when the file is opened, a
+// frame is reconstructed from the preceding keyframe, or from the previous reconstruction when reading forward.
+class MapHistoryReader {
+
+    public:
+        // Constructor and destructor
+        MapHistoryReader(const string& file_path);
+        ~MapHistoryReader();
+
+        MapHistoryReader(const MapHistoryReader& reader) = delete;
+        MapHistoryReader& operator=(const MapHistoryReader& reader) = delete;
+
+        // Print history summary
+        void summary();
+
+        // Grid of a frame
+        cv::Mat read(const int& frame_id);
+
+        // Grid of the last frame saved at or before a simulation step
+        cv::Mat readStep(const int& step);
+
+        // Getter functions
+        int getNFrames() const { return (int) this->frames.size(); };
+        const int& getStep(const int& frame_id) const { return this->frames[frame_id].step; };
+
+    private:
+        // Frame header and position of its tile entries in the file
+        typedef struct {
+            int step;
+            bool keyframe;
+            int n_tiles;
+            long offset;
+            uint32_t payload_size;
+        } FrameIndex;
+
+        // Apply tiles of a frame to the current grid
+        void apply_frame(const int& frame_id);
+
+        FILE* file;
+        string file_path;
+        MapHistoryHeader header;
+        int n_tiles_x; // number of tiles per row
+        int n_tiles_y; // number of tiles per column
+        vector<FrameIndex> frames;
+        vector<vector<uchar>> tiles; // tiles of the current grid
+        int current_frame; // frame of the current grid, -1 if none
+        vector<uchar> payload; // tile entries of the frame being applied
+
+};
+
+#endif /* MapHistory_h */
@@ -0,0 +1,161 @@
+//
+//  ParticleSet.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 16.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include "ParticleSet.h"
+#include "Map.h"
+
+using namespace std;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Standard constructor
+ParticleSet::ParticleSet() : ParticleSet(0) {}
+
+
+// Constructor
+ParticleSet::ParticleSet(int n_particles) {
+
+    // Initialize all particles at the origin with equal weight
+    this->x = Eigen::ArrayXf::Zero(n_particles);
+    this->y = Eigen::ArrayXf::Zero(n_particles);
+    this->theta = Eigen::ArrayXf::Zero(n_particles);
+    this->last_x = Eigen::ArrayXf::Zero(n_particles);
+    this->last_y = Eigen::ArrayXf::Zero(n_particles);
+    this->last_theta = Eigen::ArrayXf::Zero(n_particles);
+    this->weights = Eigen::ArrayXd::Ones(n_particles);
+
+    // Create a map, an empty measurement estimate and an empty likelihood field for each particle
+    this->maps = vector<Map>(n_particles);
+    this->measurement_estimates = vector<Eigen::MatrixX2f>(n_particles);
+    this->likelihood_fields = vector<LikelihoodField>(n_particles);
+
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void ParticleSet::summary(const int& particle_id){
+
+    cout << "Particle:" << endl;
+    cout << "---------" << endl;
+    cout << "Pose: x: " << this->x(particle_id) << "m | y: " << this->y(particle_id) << "m | theta: " << this->theta(particle_id) << "rad" << endl;
+    cout << "Weight: " << this->weights(particle_id) << endl;
+
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++ Array Functions ++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Add copies of particles. Copying a map only shares its tiles, so new particles don't construct maps of their
+// own (which would read the ground truth map in localization mode).
+void ParticleSet::appendCopies(const vector<int>& source_ids){
+
+    const int n_previous = this->size();
+    const int n_particles = n_previous + (int) source_ids.size();
+
+    this->x.conservativeResize(n_particles);
+    this->y.conservativeResize(n_particles);
+    this->theta.conservativeResize(n_particles);
+    this->last_x.conservativeResize(n_particles);
+    this->last_y.conservativeResize(n_particles);
+    this->last_theta.conservativeResize(n_particles);
+    this->weights.conservativeResize(n_particles);
+    this->maps.reserve(n_particles);
+    this->measurement_estimates.resize(n_particles);
+    this->likelihood_fields.reserve(n_particles);
+
+    for (int copy_id = 0; copy_id < (int) source_ids.size(); copy_id++){
+        const int source_id = source_ids[copy_id];
+        const int target_id = n_previous + copy_id;
+        this->x(target_id) = this->x(source_id);
+        this->y(target_id) = this->y(source_id);
+        this->theta(target_id) = this->theta(source_id);
+        this->last_x(target_id) = this->last_x(source_id);
+        this->last_y(target_id) = this->last_y(source_id);
+        this->last_theta(target_id) = this->last_theta(source_id);
+        this->weights(target_id) = this->weights(source_id);
+        this->maps.push_back(this->maps[source_id]);
+        this->likelihood_fields.push_back(this->likelihood_fields[source_id]);
+    }
+}
+
+
+// Remove all particles beyond the first n_particles
+void ParticleSet::truncate(const int& n_particles){
+
+    if (n_particles >= this->size()){
+        return; }
+
+    this->x.conservativeResize(n_particles);
+    this->y.conservativeResize(n_particles);
+    this->theta.conservativeResize(n_particles);
+    this->last_x.conservativeResize(n_particles);
+    this->last_y.conservativeResize(n_particles);
+    this->last_theta.conservativeResize(n_particles);
+    this->weights.conservativeResize(n_particles);
+    this->maps.erase(this->maps.begin() + n_particles, this->maps.end());
+    this->measurement_estimates.erase(this->measurement_estimates.begin() + n_particles, this->measurement_estimates.end());
+    this->likelihood_fields.erase(this->likelihood_fields.begin() + n_particles, this->likelihood_fields.end());
+}
+
+
+// Overwrite a particle with a copy of another one
+void ParticleSet::copyParticle(const int& source_id, const int& target_id){
+
+    this->x(target_id) = this->x(source_id);
+    this->y(target_id) = this->y(source_id);
+    this->theta(target_id) = this->theta(source_id);
+    this->last_x(target_id) = this->last_x(source_id);
+    this->last_y(target_id) = this->last_y(source_id);
+    this->last_theta(target_id) = this->last_theta(source_id);
+    this->weights(target_id) = this->weights(source_id);
+    this->maps[target_id] = this->maps[source_id];
+    this->likelihood_fields[target_id] = this->likelihood_fields[source_id];
+}
+
+
+// Overwrite a particle with another one, the map and likelihood field of the source are moved
+void ParticleSet::moveParticle(const int& source_id, const int& target_id){
+
+    this->x(target_id) = this->x(source_id);
+    this->y(target_id) = this->y(source_id);
+    this->theta(target_id) = this->theta(source_id);
+    this->last_x(target_id) = this->last_x(source_id);
+    this->last_y(target_id) = this->last_y(source_id);
+    this->last_theta(target_id) = this->last_theta(source_id);
+    this->weights(target_id) = this->weights(source_id);
+    this->maps[target_id] = move(this->maps[source_id]);
+    this->likelihood_fields[target_id] = move(this->likelihood_fields[source_id]);
+}
+
+
+// Set last poses of all particles to their current poses
+void ParticleSet::storeLastPoses(){
+
+    this->last_x = this->x;
+    this->last_y = this->y;
+    this->last_theta = this->theta;
+}
+
+
+// Get index of the particle with the highest weight
+int ParticleSet::getBestParticle() const {
+
+    Eigen::Index best_particle_id = 0;
+    if (this->size() > 0){
+        this->weights.maxCoeff(&best_particle_id);
+    }
+    return (int) best_particle_id;
+}
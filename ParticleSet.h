@@ -0,0 +1,93 @@
+//
+//  ParticleSet.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 07.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef ParticleSet_h
+#define ParticleSet_h
+
+#include <vector>
+#include <iostream>
+#include <Eigen/Dense>
+
+#include "Map.h"
+#include "LikelihoodField.h"
+
+using namespace std;
+
+
+// Container for all particles of the filter. Poses, last poses and weights are stored as contiguous arrays
+// (structure of arrays) so that filter steps operating on all particles are linear, vectorizable passes.
+// Individual particles are accessed by their index.
+class ParticleSet{
+
+    public:
+        // Constructor and destructor
+        ParticleSet();
+        ParticleSet(int n_particles);
+        ~ParticleSet(){};
+
+        // Print summary of a particle
+        void summary(const int& particle_id);
+
+        // Number of particles
+        int size() const { return (int) this->weights.size(); };
+
+        // Add copies of particles, maps and likelihood fields share their tiles with the source particles
+        void appendCopies(const vector<int>& source_ids);
+
+        // Remove all particles beyond the first n_particles
+        void truncate(const int& n_particles);
+
+        // Getter functions for individual particles
+        Eigen::Vector3f getPose(const int& particle_id) const { return Eigen::Vector3f(this->x(particle_id), this->y(particle_id), this->theta(particle_id)); };
+        Eigen::Vector3f getLastPose(const int& particle_id) const { return Eigen::Vector3f(this->last_x(particle_id), this->last_y(particle_id), this->last_theta(particle_id)); };
+        double& getWeight(const int& particle_id){ return this->weights(particle_id); };
+        Map& getMap(const int& particle_id){ return this->maps[particle_id]; };
+        Eigen::MatrixX2f& getMeasurementEstimate(const int& particle_id){ return this->measurement_estimates[particle_id]; };
+        LikelihoodField& getLikelihoodField(const int& particle_id){ return this->likelihood_fields[particle_id]; };
+
+        // Setter functions for individual particles
+        void setPose(const int& particle_id, const Eigen::Vector3f& pose){ this->x(particle_id) = pose(0); this->y(particle_id) = pose(1); this->theta(particle_id) = pose(2); };
+
+        // Getter functions for the arrays of all particles
+        Eigen::ArrayXf& getX(){ return this->x; };
+        Eigen::ArrayXf& getY(){ return this->y; };
+        Eigen::ArrayXf& getTheta(){ return this->theta; };
+        Eigen::ArrayXf& getLastX(){ return this->last_x; };
+        Eigen::ArrayXf& getLastY(){ return this->last_y; };
+        Eigen::ArrayXf& getLastTheta(){ return this->last_theta; };
+        Eigen::ArrayXd& getWeights(){ return this->weights; };
+        vector<Map>& getMaps(){ return this->maps; };
+        vector<LikelihoodField>& getLikelihoodFields(){ return this->likelihood_fields; };
+
+        // Overwrite a particle with a copy of another one, maps and likelihood fields share their tiles
+        void copyParticle(const int& source_id, const int& target_id);
+
+        // Overwrite a particle with another one whose map and likelihood field are no longer needed
+        void moveParticle(const int& source_id, const int& target_id);
+
+        // Set last poses of all particles to their current poses
+        void storeLastPoses();
+
+        // Get index of the particle with the highest weight
+        int getBestParticle() const;
+
+    private:
+        Eigen::ArrayXf x; // x positions of all particles
+        Eigen::ArrayXf y; // y positions of all particles
+        Eigen::ArrayXf theta; // headings of all particles
+        Eigen::ArrayXf last_x; // x positions at the last update
+        Eigen::ArrayXf last_y; // y positions at the last update
+        Eigen::ArrayXf last_theta; // headings at the last update
+        Eigen::ArrayXd weights; // current weights of all particles
+        vector<Map> maps; // particles' estimated grid maps of the environment
+        vector<Eigen::MatrixX2f> measurement_estimates; // particles' estimated measurements
+        vector<LikelihoodField> likelihood_fields; // distance fields of the particles' maps
+
+};
+
+#endif /* ParticleSet_h */
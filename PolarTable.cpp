@@ -0,0 +1,55 @@
+//
+//  PolarTable.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 21.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <math.h>
+
+#include "PolarTable.h"
+#include "Map.h"
+
+using namespace std;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+PolarTable::PolarTable(){
+
+    // Empty table, built on the first update
+    this->map_range = -1;
+    this->size = 0;
+    this->map_version = -1;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Build Table ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void PolarTable::update(Sensor& sensor){
+
+    // Keep table if sensor range and map parameters didn't change
+    const int map_range = Map::world2map(sensor.getRange());
+    if (map_range == this->map_range && Map::getParameterVersion() == this->map_version) {
+        return; }
+
+    this->map_range = map_range;
+    this->size = 2 * map_range + 1;
+    this->map_version = Map::getParameterVersion();
+    this->distances.resize(this->size * this->size);
+    this->angles.resize(this->size * this->size);
+
+    // Compute polar coordinates of all offsets
+    for (int dy = -map_range; dy <= map_range; dy++) {
+        for (int dx = -map_range; dx <= map_range; dx++) {
+            const int table_id = (dy + map_range) * this->size + (dx + map_range);
+            this->distances[table_id] = sqrt(pow((float)dx, 2) + pow((float)dy, 2));
+            this->angles[table_id] = atan2((float)dy, (float)dx);
+        }
+    }
+}
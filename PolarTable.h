@@ -0,0 +1,51 @@
+//
+//  PolarTable.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 21.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef PolarTable_h
+#define PolarTable_h
+
+#include <vector>
+
+#include "Sensor.h"
+
+using namespace std;
+
+
+// Lookup table of the polar coordinates of all grid cells within sensor range relative to the robot's cell.
+// Distances and angles only depend on the integer offset (dx, dy) between the cells, so the table is shared by
+// all particles and time steps. Angles are stored in the map frame (atan2(dy, dx)), the robot's heading is
+// subtracted by the caller. The table is rebuilt only if the sensor range or the map parameters change.
+class PolarTable {
+
+    public:
+        // Constructor and destructor
+        PolarTable();
+        ~PolarTable(){};
+
+        // Rebuild table if the sensor range or the map parameters changed since the last build
+        void update(Sensor& sensor);
+
+        // Distance between the mass centers of the robot's cell and the cell at offset (dx, dy)
+        const float& getDistance(const int& dx, const int& dy) const { return this->distances[(dy + this->map_range) * this->size + (dx + this->map_range)]; };
+
+        // Angle of the cell at offset (dx, dy) in the map frame
+        const float& getAngle(const int& dx, const int& dy) const { return this->angles[(dy + this->map_range) * this->size + (dx + this->map_range)]; };
+
+        // Getter functions
+        const int& getMapRange() const { return this->map_range; };
+
+    private:
+        int map_range; // sensor range in map coordinates, table covers offsets in [-map_range, map_range]
+        int size; // number of offsets along each axis
+        int map_version; // version of the map parameters the table was built for
+        vector<float> distances; // distance of each offset
+        vector<float> angles; // angle of each offset
+
+};
+
+#endif /* PolarTable_h */
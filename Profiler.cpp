@@ -0,0 +1,136 @@
+//
+//  Profiler.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 06.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <math.h>
+
+#include "Profiler.h"
+
+using namespace std;
+
+// Initialize static members
+bool Profiler::enabled = false;
+atomic<long long> Profiler::step_times[NStages] = {};
+atomic<int> Profiler::step_calls[NStages] = {};
+atomic<long> Profiler::step_counts[NCounters] = {};
+vector<double> Profiler::stage_samples[NStages];
+vector<double> Profiler::counter_samples[NCounters];
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void Profiler::summary(){
+    
+    double min, mean, p99, total;
+    
+    cout << "Profile:" << endl;
+    cout << "--------" << endl;
+    for (int stage = 0; stage < NStages; stage++) {
+        Profiler::statistics(Profiler::stage_samples[stage], min, mean, p99, total);
+        cout << profile_stage_names[stage] << ": min " << min << "ms | mean " << mean << "ms | p99 " << p99 << "ms | total " << total << "ms" << endl;
+    }
+    for (int counter = 0; counter < NCounters; counter++) {
+        Profiler::statistics(Profiler::counter_samples[counter], min, mean, p99, total);
+        cout << profile_counter_names[counter] << ": min " << min << " | mean " << mean << " | p99 " << p99 << " | total " << total << endl;
+    }
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Accumulation +++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void Profiler::add_time(const int& stage, const long long& nanoseconds){
+    
+    Profiler::step_times[stage] += nanoseconds;
+    Profiler::step_calls[stage]++;
+}
+
+
+void Profiler::add_count(const int& counter, const long& n){
+    
+    Profiler::step_counts[counter] += n;
+}
+
+
+// Store the current step. Stages only contribute a sample in steps in which they ran, counters in every step.
+void Profiler::end_step(){
+    
+    if (!Profiler::enabled) {
+        return; }
+    
+    for (int stage = 0; stage < NStages; stage++) {
+        if (Profiler::step_calls[stage] > 0) {
+            Profiler::stage_samples[stage].push_back(Profiler::step_times[stage] * 1e-6);
+        }
+        Profiler::step_times[stage] = 0;
+        Profiler::step_calls[stage] = 0;
+    }
+    for (int counter = 0; counter < NCounters; counter++) {
+        Profiler::counter_samples[counter].push_back((double) Profiler::step_counts[counter]);
+        Profiler::step_counts[counter] = 0;
+    }
+}
+
+
+// Minimum, mean, 99th percentile (nearest rank) and sum of a set of samples, all 0 for an empty set
+void Profiler::statistics(vector<double> samples, double& min, double& mean, double& p99, double& total){
+    
+    min = mean = p99 = total = 0;
+    if (samples.empty()) {
+        return; }
+    
+    sort(samples.begin(), samples.end());
+    for (vector<double>::iterator it = samples.begin(); it != samples.end(); it++) {
+        total += *it; }
+    min = samples.front();
+    mean = total / samples.size();
+    p99 = samples[(int) ceil(0.99 * samples.size()) - 1];
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++ Export ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void Profiler::save(const string& result_dir){
+    
+    ofstream csv_file(result_dir + "/profile.csv");
+    ofstream json_file(result_dir + "/profile.json");
+    if (!csv_file.is_open() || !json_file.is_open()) {
+        cout << "Unable to write profile to " << result_dir << endl;
+        return;
+    }
+    
+    double min, mean, p99, total;
+    
+    // One row per stage (times in ms) and counter
+    csv_file << "type,name,n,min,mean,p99,total" << endl;
+    json_file << "{" << endl;
+    json_file << "  \"stages\": {" << endl;
+    for (int stage = 0; stage < NStages; stage++) {
+        const vector<double>& samples = Profiler::stage_samples[stage];
+        Profiler::statistics(samples, min, mean, p99, total);
+        csv_file << "stage," << profile_stage_names[stage] << "," << samples.size() << "," << min << "," << mean << "," << p99 << "," << total << endl;
+        json_file << "    \"" << profile_stage_names[stage] << "\": {\"n\": " << samples.size() << ", \"min_ms\": " << min << ", \"mean_ms\": " << mean << ", \"p99_ms\": " << p99 << ", \"total_ms\": " << total << "}" << (stage < NStages - 1 ? "," : "") << endl;
+    }
+    json_file << "  }," << endl;
+    json_file << "  \"counters\": {" << endl;
+    for (int counter = 0; counter < NCounters; counter++) {
+        const vector<double>& samples = Profiler::counter_samples[counter];
+        Profiler::statistics(samples, min, mean, p99, total);
+        csv_file << "counter," << profile_counter_names[counter] << "," << samples.size() << "," << min << "," << mean << "," << p99 << "," << total << endl;
+        json_file << "    \"" << profile_counter_names[counter] << "\": {\"n\": " << samples.size() << ", \"min\": " << min << ", \"mean\": " << mean << ", \"p99\": " << p99 << ", \"total\": " << total << "}" << (counter < NCounters - 1 ? "," : "") << endl;
+    }
+    json_file << "  }" << endl;
+    json_file << "}" << endl;
+}
@@ -0,0 +1,142 @@
+//
+//  Profiler.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 06.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef Profiler_h
+#define Profiler_h
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include "Tracer.h"
+
+using namespace std;
+
+// Stages of a filter step timed by the profiler
+enum profile_stage {
+    StageStep,
+    StagePredict,
+    StageSweepEstimate,
+    StageScanMatching,
+    StageImprovedProposal,
+    StageWeight,
+    StageResampling,
+    StageMapping,
+    StageLikelihoodField,
+    NStages,
+};
+
+// Events counted by the profiler
+enum profile_counter {
+    CounterRayCastCells,
+    CounterOccupiedCellsHit,
+    CounterMappedCells,
+    CounterScanMatchingIterations,
+    CounterResampleEvents,
+    NCounters,
+};
+
+// String names of stages and counters
+const string profile_stage_names [] {
+    "step",
+    "predict",
+    "sweep_estimate",
+    "scan_matching",
+    "improved_proposal",
+    "weight",
+    "resampling",
+    "mapping",
+    "likelihood_field",
+};
+const string profile_counter_names [] {
+    "ray_cast_cells",
+    "occupied_cells_hit",
+    "mapped_cells",
+    "scan_matching_iterations",
+    "resample_events",
+};
+
+
+// Aggregates stage timings and event counts of all filter steps. Times and counts of the current step are
+// accumulated atomically, so stages running per particle on the worker threads report the time summed over all
+// particles, while the step stage reports the wall time of the step. Profiling is disabled unless enabled at
+// runtime, a disabled timer only checks a flag. Defining FASTSLAM_NO_PROFILING removes all instrumentation.
+class Profiler {
+
+    public:
+        // Print min, mean and 99th percentile of all stages and counters
+        static void summary();
+
+        // Accumulate time of a stage and events of a counter in the current step
+        static void add_time(const int& stage, const long long& nanoseconds);
+        static void add_count(const int& counter, const long& n);
+
+        // Store accumulated times and counts of the current step and start a new one
+        static void end_step();
+
+        // Write statistics of all stages and counters to profile.csv and profile.json in the result directory
+        static void save(const string& result_dir);
+
+        // Static getter and setter
+        static const bool& isEnabled(){ return Profiler::enabled; };
+        static void setEnabled(bool enabled){ Profiler::enabled = enabled; };
+
+    private:
+        // Minimum, mean, 99th percentile and sum of a set of samples
+        static void statistics(vector<double> samples, double& min, double& mean, double& p99, double& total);
+
+        static bool enabled;
+        static atomic<long long> step_times[NStages]; // time of each stage in the current step in ns
+        static atomic<int> step_calls[NStages]; // number of times each stage was entered in the current step
+        static atomic<long> step_counts[NCounters]; // events of each counter in the current step
+        static vector<double> stage_samples[NStages]; // time of each stage per step in ms
+        static vector<double> counter_samples[NCounters]; // events of each counter per step
+
+};
+
+
+// Measures the time between its construction and destruction, adds it to a stage and records it as event of the
+// trace if the tracer is enabled
+class ScopedTimer {
+
+    public:
+        ScopedTimer(const int& stage){
+            this->stage = stage;
+            this->active = Profiler::isEnabled() || Tracer::isEnabled();
+            if (this->active) {
+                this->start = chrono::steady_clock::now(); }
+        };
+        ~ScopedTimer(){
+            if (this->active) {
+                const chrono::steady_clock::time_point end = chrono::steady_clock::now();
+                if (Profiler::isEnabled()) {
+                    Profiler::add_time(this->stage, chrono::duration_cast<chrono::nanoseconds>(end - this->start).count()); }
+                if (Tracer::isEnabled()) {
+                    Tracer::record(profile_stage_names[this->stage].c_str(), this->start, end); }
+            }
+        };
+
+    private:
+        int stage;
+        bool active;
+        chrono::steady_clock::time_point start;
+
+};
+
+
+// Instrumentation macros, compiled out if FASTSLAM_NO_PROFILING is defined
+#ifdef FASTSLAM_NO_PROFILING
+#define PROFILE_SCOPE(stage)
+#define PROFILE_COUNT(counter, n) do {} while (0)
+#else
+#define PROFILE_SCOPE(stage) ScopedTimer scoped_timer(stage)
+#define PROFILE_COUNT(counter, n) do { if (Profiler::isEnabled()) { Profiler::add_count(counter, n); } } while (0)
+#endif
+
+#endif /* Profiler_h */
@@ -10,16 +10,26 @@
 #include <random>
 #include <math.h>
 #include <algorithm>
+#include <limits>
+#include <unordered_set>
 
 #include "RBPF.h"
 #include "Robot.h"
+#include "RandomStream.h"
+#include "Profiler.h"
 
 using namespace std;
 
-extern default_random_engine engine;
-
 #define PI 3.14159265
 
+// Inverse sensor model parameters
+const float OBJECT_THICKNESS = 1.0; // thickness of object in map coordinates
+const float BEAM_WIDTH = 0.1; // width of a laser beam in map coordinates
+
+// Likelihood field model parameters
+const float Z_HIT = 0.95; // weight of the gaussian around the nearest obstacle
+const float Z_RANDOM = 0.05; // weight of uniformly distributed random measurements
+
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -33,30 +43,101 @@ RBPF::RBPF(){
     this->R(1) = 0.01;
     this->R(2) = 0.01;
     
-    // Initialize particles
-    for (int i = 0; i < this->n_particles; i++) {
-        Particle particle = Particle();
-        this->particles.push_back(particle);
-    }
+    // Initialize particles, the number of particles is fixed unless KLD-sampling is enabled
+    this->particles = ParticleSet(this->n_particles);
+    this->n_samples = 20;
+    this->resampler = Resampler();
+    this->kld_sampling = 0;
+    this->verbose = 0;
+    this->n_particles_min = this->n_particles;
+    this->n_particles_max = this->n_particles;
+    this->kld_epsilon = 0.05;
+    this->kld_z = 2.326;
+    this->kld_bin_size_xy = 0.25;
+    this->kld_bin_size_theta = 10 * PI / 180;
+    
+    // Create worker pool with one thread per hardware thread
+    this->thread_pool = make_shared<ThreadPool>();
+    
+    // Create one scan matcher per worker thread, use ICP on estimated scans
+    this->scan_matchers = vector<ScanMatcher>(this->thread_pool->getNThreads());
+    this->grid_matchers = vector<GridMatcher>(this->thread_pool->getNThreads());
+    this->correlative_matchers = vector<CorrelativeMatcher>(this->thread_pool->getNThreads());
+    this->scan_matching_mode = 0;
+    this->n_scan_matching_iterations = 0;
+    
+    // Use one grid map per particle, updated with the inverse sensor model
+    this->map_representation = 0;
+    this->mapping_mode = 0;
+    
+    // Weight particles with the beam model on ray-cast measurement estimates
+    this->measurement_model = 0;
     
     this->last_timestamp = 0.0;
+    this->step = 0;
 }
 
 // Constructor
-RBPF::RBPF(int n_particles, Eigen::Vector3f R, int max_iterations, float tolerance, float discard_fraction): scan_matcher(max_iterations, tolerance, discard_fraction){
+RBPF::RBPF(int n_particles, Eigen::Vector3f R, int max_iterations, float tolerance, float discard_fraction, int n_threads, int map_representation, int mapping_mode, int scan_matching_mode, float search_window_linear, float search_window_angular, int measurement_model){
     
     this->n_particles = n_particles;
     this->R(0) = R(0);
     this->R(1) = R(1);
     this->R(2) = R(2);
     
-    // Initialize particles
-    for (int i = 0; i < this->n_particles; i++) {
-        Particle particle = Particle();
-        this->particles.push_back(particle);
+    // Initialize particles, the number of particles is fixed unless KLD-sampling is enabled
+    this->particles = ParticleSet(this->n_particles);
+    this->n_samples = 20;
+    this->resampler = Resampler();
+    this->kld_sampling = 0;
+    this->verbose = 0;
+    this->n_particles_min = this->n_particles;
+    this->n_particles_max = this->n_particles;
+    this->kld_epsilon = 0.05;
+    this->kld_z = 2.326;
+    this->kld_bin_size_xy = 0.25;
+    this->kld_bin_size_theta = 10 * PI / 180;
+    
+    // Create worker pool (n_threads = 0 -> one thread per hardware thread)
+    this->thread_pool = make_shared<ThreadPool>(n_threads);
+    
+    // Create one scan matcher per worker thread
+    this->scan_matchers = vector<ScanMatcher>(this->thread_pool->getNThreads(), ScanMatcher(max_iterations, tolerance, discard_fraction));
+    this->grid_matchers = vector<GridMatcher>(this->thread_pool->getNThreads(), GridMatcher(max_iterations, tolerance));
+    this->correlative_matchers = vector<CorrelativeMatcher>(this->thread_pool->getNThreads(), CorrelativeMatcher(search_window_linear, search_window_angular));
+    
+    // Set scan matching mode (0 -> ICP on estimated scans, 1 -> Gauss-Newton scan-to-map matching,
+    // 2 -> correlative scan-to-map matching)
+    this->scan_matching_mode = scan_matching_mode;
+    this->n_scan_matching_iterations = 0;
+    
+    // Create map shared by all particles if specified (0 -> one grid map per particle, 1 -> ancestry map)
+    this->map_representation = map_representation;
+    if (this->map_representation == 1){
+        this->ancestry_map = make_shared<AncestryMap>(this->n_particles);
     }
     
+    // Set mapping mode (0 -> inverse sensor model on all cells within range, 1 -> trace measured beams)
+    this->mapping_mode = mapping_mode;
+    
+    // Set measurement model (0 -> beam model on ray-cast measurement estimates, 1 -> likelihood field)
+    this->measurement_model = measurement_model;
+    
     this->last_timestamp = 0.0;
+    this->step = 0;
+}
+
+
+// Enable KLD-sampling, the number of particles is adapted in every resampling step within the given bounds
+void RBPF::setKLDSampling(int n_particles_min, int n_particles_max, float epsilon, float z, float bin_size_xy, float bin_size_theta){
+    
+    this->kld_sampling = 1;
+    this->n_particles_min = max(n_particles_min, 1);
+    this->n_particles_max = max(n_particles_max, this->n_particles_min);
+    this->kld_epsilon = epsilon;
+    this->kld_z = z;
+    this->kld_bin_size_xy = bin_size_xy;
+    this->kld_bin_size_theta = bin_size_theta;
 }
 
 
@@ -69,9 +150,25 @@ void RBPF::summary(){
     cout << "RBPF:" << endl;
     cout << "-----" << endl;
     cout << "Number of Particles: " << this->n_particles << endl;
+    if (this->kld_sampling == 1){
+        cout << "KLD-Sampling: " << this->n_particles_min << " to " << this->n_particles_max << " Particles | epsilon: " << this->kld_epsilon << " | z: " << this->kld_z << endl;
+    }
     cout << "Motion Uncertainty: " << this->R(0) << "m, " << this->R(1) << "m, " << this->R(2) << "rad" << endl;
     // Print scan matcher summary
-    this->getScanMatcher().summary();
+    if (this->scan_matching_mode == 1){
+        this->getGridMatcher().summary(); }
+    else if (this->scan_matching_mode == 2){
+        this->getCorrelativeMatcher().summary(); }
+    else {
+        this->getScanMatcher().summary(); }
+    // Print resampler summary
+    this->resampler.summary();
+    // Print thread pool summary
+    this->getThreadPool().summary();
+    // Print ancestry map summary
+    if (this->map_representation == 1){
+        this->ancestry_map->summary();
+    }
     
 }
 
@@ -82,33 +179,56 @@ void RBPF::summary(){
 
 void RBPF::run(Robot& robot, Eigen::Vector2f odometry_signal, const int simulation_mode){
     
+    PROFILE_SCOPE(StageStep);
+    
     // For localization and SLAM update particle poses
     if (simulation_mode == 0 || simulation_mode == 2){
         
-        // Compute prediction based on odometry information and motion model
+        // Odometry information from wheel encoder
         float v_hat = odometry_signal(0); // Estimated translational velocity from wheel encoder
         float omega_hat = odometry_signal(1); // Estimated angular velocity from wheel encoder
+        
+        // Compute prediction based on odometry information and motion model for all particles at once
         this->predict(v_hat, omega_hat, robot.getTimestamp());
         
-        // Get sensor scan estimate
-        this->sweep_estimate(robot.getSensor());
+        // Compute likelihood fields of the initial maps
+        if (this->measurement_model == 1 && this->step == 0){
+            this->initialize_likelihood_fields();
+        }
+        
+        // Container for unnormalized particle log-weights
+        Eigen::ArrayXd log_weights = Eigen::ArrayXd::Zero(this->particles.size());
+        
+        // Particles are independent until weight normalization, run the rest of the pipeline for each
+        // particle in parallel
+        this->thread_pool->parallel_for(this->particles.size(), [&](int particle_id, int worker_id){
             
-        // Run scan matching to compute pose correction
-        this->scan_matching(robot.getPose(), robot.getSensor());
+            // Get sensor scan estimate (not required to match the scan to the map directly)
+            if (this->scan_matching_mode == 0){
+                this->cast_particle(particle_id, this->particles.getPose(particle_id), robot.getSensor(), this->particles.getMeasurementEstimate(particle_id));
+            }
+            
+            // Run scan matching to compute pose correction
+            this->scan_matching_particle(particle_id, worker_id, robot.getPose(), robot.getSensor());
+            
+            // Sample final pose from improved proposal and compute weight
+            log_weights(particle_id) = this->improved_proposal_particle(particle_id, robot.getSensor(), odometry_signal, robot.getTimestamp());
+        });
+        
+        // Report cost of scan matching in the current step
+        this->count_scan_matching_iterations();
         
-        // Get sensor scan estimate
-        this->improved_proposal(robot.getSensor(), odometry_signal, robot.getTimestamp());
+        // Normalize weights of all particles
+        this->normalize_weights(log_weights);
         
         // Compute efficient number of particles
-        float squared_sum = 0;
-        for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
-            squared_sum += pow((*it).getWeight(), 2);
-        }
-        float Neff = 1 / squared_sum;
-        cout << "Neff: " << Neff << endl;
+        float Neff = (float) (1.0 / this->particles.getWeights().square().sum());
+        if (this->verbose >= 1){
+            cout << "Neff: " << Neff << endl;}
             
-        // Resample particles based on computed weights if Neff drops below threshold
-        if (Neff < (this->n_particles/2)){
+        // Resample particles based on computed weights if Neff drops below threshold. With KLD-sampling the
+        // particles are resampled in every step to adapt their number to the current spread of the posterior.
+        if (Neff < (this->n_particles/2) || this->kld_sampling == 1){
             this->resample();
         }
     }
@@ -116,8 +236,8 @@ void RBPF::run(Robot& robot, Eigen::Vector2f odometry_signal, const int simulati
     // For mapping set particle poses to current robot pose (mapping with known poses)
     else {
         
-        for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
-            (*it).getPose() = robot.getPose();
+        for (int particle_id = 0; particle_id < this->particles.size(); particle_id++) {
+            this->particles.setPose(particle_id, robot.getPose());
         }
     }
     
@@ -126,8 +246,9 @@ void RBPF::run(Robot& robot, Eigen::Vector2f odometry_signal, const int simulati
         this->mapping(robot.getSensor());
     }
     
-    // Update timestamp
+    // Update timestamp and step counter
     this->last_timestamp = robot.getTimestamp();
+    this->step++;
 }
 
 
@@ -137,36 +258,42 @@ void RBPF::run(Robot& robot, Eigen::Vector2f odometry_signal, const int simulati
 
 // Apply motion model based on odometry information from wheel encoder
 void RBPF::predict(const float &v, const float &omega, const float& current_timestamp){
-
-    // Create standard normal distribution for sampling
-    normal_distribution<float> distribution(0.0, 1.0);
+    
+    PROFILE_SCOPE(StagePredict);
     
     // Get sampling time
     float delta_t = current_timestamp - this->last_timestamp;
     
-    // Iterate over all particles
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
-        
-        // Set current pose to last pose
-        (*it).setLastPose((*it).getPoseCopy());
-        
-        // Pose difference due to control signal since last update
-        Eigen::Vector3f pose_dif;
-        pose_dif(0) = delta_t * v * cos((float)(*it).getPose()(2));
-        pose_dif(1) = delta_t * v * sin((float)(*it).getPose()(2));
-        pose_dif(2) = delta_t * omega;
-        
-        // Update pose
-        (*it).getPose() += pose_dif;
-        
-        // Apply uncorrelated noise
-        (*it).getPose()(0) += (this->R(0) * distribution(engine));
-        (*it).getPose()(1) += (this->R(1) * distribution(engine));
-        (*it).getPose()(2) += (this->R(2) * distribution(engine));
-        // Limit heading to range [-pi, pi)
-        (*it).getPose()(2) = fmod((float)(*it).getPose()(2)+PI, 2*PI) - PI;
-                
+    // Set current poses to last poses
+    this->particles.storeLastPoses();
+    
+    // Draw uncorrelated motion noise, each particle uses its own random stream in the current step
+    const int n_particles = this->particles.size();
+    Eigen::ArrayXf noise_x(n_particles), noise_y(n_particles), noise_theta(n_particles);
+    for (int particle_id = 0; particle_id < n_particles; particle_id++){
+        RandomStream random(this->step, particle_id, 0);
+        noise_x(particle_id) = this->R(0) * random.normal();
+        noise_y(particle_id) = this->R(1) * random.normal();
+        noise_theta(particle_id) = this->R(2) * random.normal();
     }
+    
+    // Get references to pose arrays of all particles
+    Eigen::ArrayXf& x = this->particles.getX();
+    Eigen::ArrayXf& y = this->particles.getY();
+    Eigen::ArrayXf& theta = this->particles.getTheta();
+    
+    // Update poses with pose difference due to control signal since last update
+    x += delta_t * v * theta.cos();
+    y += delta_t * v * theta.sin();
+    theta += delta_t * omega;
+    
+    // Apply motion noise
+    x += noise_x;
+    y += noise_y;
+    theta += noise_theta;
+    
+    // Limit heading to range [-pi, pi)
+    theta = theta.unaryExpr([](float t){ return (float) (fmod(t+PI, 2*PI) - PI); });
 }
 
 
@@ -177,104 +304,32 @@ void RBPF::predict(const float &v, const float &omega, const float& current_time
 // Estimate sensor sweep from particles' maps
 void RBPF::sweep_estimate(Sensor &sensor){
     
-    // Iterate over all particles
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
+    // Iterate over all particles in parallel
+    this->thread_pool->parallel_for(this->particles.size(), [&](int particle_id, int worker_id){
         
-        // Transform robot pose from world coordinates to map coordinates
-        Eigen::Array3f map_pose = Map::world2map((*it).getPose());
+        // Cast laser beams through the particle's map
+        this->cast_particle(particle_id, this->particles.getPose(particle_id), sensor, this->particles.getMeasurementEstimate(particle_id));
+    });
+}
 
-        // Get mass center of robot's center pixel
-        const float xc_r = (float) map_pose(0) + 0.5;
-        const float yc_r = (float) map_pose(1) + 0.5;
-        const float heading_r = (float) map_pose(2);
-        
-        // Transform sensor's maximum range to map scale
-        int map_range = Map::world2map(sensor.getRange());
-        
-        // Instantiate container for estimated measurements
-        (*it).getMeasurementEstimate() = Eigen::MatrixX2f::Ones(sensor.getN(), 2) * sensor.getRange(); // Initialize measurements to sensor range
-        (*it).getMeasurementEstimate().col(0) = Eigen::ArrayXf::LinSpaced(sensor.getN(), -PI/180*sensor.getFoV()/2, PI/180*sensor.getFoV()/2); // Set angle for each laser beam
-        
-        // Get reference to real laser measurements
-        Eigen::MatrixX2f measurement_ref = sensor.getMeasurements();
-        
-        // Get reference to the currently inspected particle's map data
-        cv::Mat map_ref = (*it).getMap().getData();
-        
-        // Iterate over all vertical pixels within range of the sensor from robot's current position
-        for (int y_px = ((int)map_pose(1) - map_range); y_px <= ((int)(map_pose(1) + map_range)); y_px++) {
-            // Check that index lies within map boundaries
-            if (y_px >= 0 && y_px < (int)(Map::getHeight() / Map::getResolution())) {
-                
-                // Get a pointer to the beginning of the currently inspected row to access all relevant
-                // horizontal pixels
-                uchar* horizontal_pixel_ptr = map_ref.ptr<uchar>(y_px);
-                
-                // Iterate over all horizontal pixels within range of the sensor from robot's current position
-                for (int x_px = ((int)map_pose(0) - map_range); x_px <= ((int)(map_pose(0) + map_range)); x_px++) {
-                    // Check that index lies within map boundaries
-                    if (x_px >= 0 && x_px < (int)(Map::getWidth() / Map::getResolution())) {
-                    
-                        // Update estimated scan only if occupied cell detected
-                        if (horizontal_pixel_ptr[x_px] < Map::getThreshold()) {
-                            
-                            // Get mass center of currently inspected pixel
-                            const float xc_px = x_px + 0.5;
-                            const float yc_px = y_px + 0.5;
-                            
-                            // Compute relative angles of all corner points of currently inspected pixel
-                            vector<float> pixel_angles;
-                            for (float i = -0.5; i <= 0.5; i+=0.5) {
-                                for (float j = -0.5; j<= 0.5; j+=0.5) {
-                                    
-                                    // Angle of currently inspected pixel relative to robot's heading
-                                    float pixel_angle = atan2((yc_px+j) - yc_r, (xc_px+i) - xc_r) - heading_r;
-                                    // Keep angle within range [-pi, pi)
-                                    if (pixel_angle < -PI) {
-                                        pixel_angle = fmod(pixel_angle-PI, 2*PI) + PI; }
-                                    else {
-                                        pixel_angle = fmod(pixel_angle+PI, 2*PI) - PI; }
-                                    
-                                    pixel_angles.push_back(pixel_angle);
-                                }
-                            }
-                            
-                            // Get minimum and maximum relative angle that hits currently inspected pixel
-                            float angle_max = *max_element(pixel_angles.begin(), pixel_angles.end());
-                            float angle_min = *min_element(pixel_angles.begin(), pixel_angles.end());
-                            
-                            // Distance from robot to mass center of currently inspected pixel
-                            const float pixel_distance = sqrt(pow(xc_px - xc_r, 2) + pow(yc_px - yc_r, 2));
-                            
-                            // Find all relevant laser beams
-                            vector <int> valid_ids;
-                            if (angle_min < -PI/2 && angle_max > PI/2) {
-                                for (int beam_id = 0; beam_id < sensor.getN(); beam_id++) {
-                                    if (measurement_ref(beam_id, 0) <= angle_min && measurement_ref(beam_id, 0) >= angle_max) {
-                                        valid_ids.push_back(beam_id);
-                                    }
-                                }
-                            }
-                            else {
-                                for (int beam_id = 0; beam_id < sensor.getN(); beam_id++) {
-                                    if (measurement_ref(beam_id, 0) >= angle_min && measurement_ref(beam_id, 0) <= angle_max) {
-                                        valid_ids.push_back(beam_id);
-                                    }
-                                }
-                            }
-                            
-                            // Update estimated distance
-                            for (vector<int>::iterator beam_it = valid_ids.begin(); beam_it != valid_ids.end(); beam_it++) {
-                                if (pixel_distance < Map::world2map((*it).getMeasurementEstimate()((*beam_it), 1))) {
-                                    (*it).getMeasurementEstimate()((*beam_it), 1) = Map::map2world((int)pixel_distance);
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
+
+// Cast laser beams of one or more poses through the map of a particle
+void RBPF::cast_particle(const int& particle_id, const Eigen::Vector3f& pose, Sensor& sensor, Eigen::MatrixX2f& measurement_estimate){
+    
+    PROFILE_SCOPE(StageSweepEstimate);
+    
+    if (this->map_representation == 1){
+        this->ray_caster.cast(*this->ancestry_map, particle_id, pose, sensor, measurement_estimate); }
+    else {
+        this->ray_caster.cast(this->particles.getMap(particle_id), pose, sensor, measurement_estimate); }
+}
+
+void RBPF::cast_particle(const int& particle_id, const vector<Eigen::Vector3f>& poses, Sensor& sensor, vector<Eigen::MatrixX2f>& measurement_estimates){
+    
+    if (this->map_representation == 1){
+        this->ray_caster.cast(*this->ancestry_map, particle_id, poses, sensor, measurement_estimates); }
+    else {
+        this->ray_caster.cast(this->particles.getMap(particle_id), poses, sensor, measurement_estimates); }
 }
 
 
@@ -325,37 +380,92 @@ Eigen::MatrixX2f polar2cart(const Eigen::Vector3f& pose, const Eigen::MatrixX2f&
 // Perform scan matching to estimate pose correction based on real and estimated measurements
 void RBPF::scan_matching(const Eigen::Vector3f &pose, Sensor& sensor){
     
-    // Iterate over all particles
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
-        
-        // Get valid indices
-        vector<int> valid_indices;
-         for (int beam_id = 0; beam_id < sensor.getMeasurements().rows(); beam_id++){
-             
-             if (sensor.getMeasurements()(beam_id, 1) < sensor.getRange() &&
-                 (*it).getMeasurementEstimate()(beam_id, 1) < sensor.getRange()){
-                 valid_indices.push_back(beam_id);
-             }
-             
-         }
-    
-        if (valid_indices.size() > 0){
-            // Transform measurements to cartesian coordinates
-            Eigen::MatrixX2f measurements_cartesian = polar2cart(pose, sensor.getMeasurements(), valid_indices);
-            
-            // Transform measurements to cartesian coordinates
-            Eigen::MatrixX2f measurement_estimate_cartesian = polar2cart((*it).getPose(), (*it).getMeasurementEstimate(), valid_indices);
-            
-            // Estimated pose correction using ICP (Iterative Closest Point) matching
-            Eigen::Vector3f pose_dif = this->scan_matcher.ICP(measurement_estimate_cartesian, measurements_cartesian, this->getR());
-            
-            // Update the particle's pose using the estimated pose correction
-            (*it).getPose() += pose_dif;
-            
-            // Limit heading to range [-pi, pi)
-            (*it).getPose()(2) = fmod((float)(*it).getPose()(2)+PI, 2*PI) - PI;
+    // Iterate over all particles in parallel
+    this->thread_pool->parallel_for(this->particles.size(), [&](int particle_id, int worker_id){
+        this->scan_matching_particle(particle_id, worker_id, pose, sensor);
+    });
+}
+
+
+// Perform scan matching for a single particle
+void RBPF::scan_matching_particle(const int& particle_id, const int& worker_id, const Eigen::Vector3f &pose, Sensor& sensor){
+    
+    PROFILE_SCOPE(StageScanMatching);
+    
+    // Align real measurements directly to the particle's map
+    if (this->scan_matching_mode != 0){
+        
+        const Eigen::Vector3f particle_pose = this->particles.getPose(particle_id);
+        Eigen::Vector3f pose_dif;
+        if (this->map_representation == 1){
+            pose_dif = this->match_grid(AncestryMap::View(*this->ancestry_map, particle_id), worker_id, particle_pose, sensor); }
+        else {
+            pose_dif = this->match_grid(this->particles.getMap(particle_id), worker_id, particle_pose, sensor); }
+        
+        // Update the particle's pose using the estimated pose correction
+        Eigen::Vector3f corrected_pose = particle_pose + pose_dif;
+        
+        // Limit heading to range [-pi, pi)
+        corrected_pose(2) = fmod((float)corrected_pose(2)+PI, 2*PI) - PI;
+        this->particles.setPose(particle_id, corrected_pose);
+        return;
+    }
+    
+    // Get reference to the particle's estimated measurements
+    const Eigen::MatrixX2f& measurement_estimate = this->particles.getMeasurementEstimate(particle_id);
+    
+    // Get valid indices
+    vector<int> valid_indices;
+    for (int beam_id = 0; beam_id < sensor.getMeasurements().rows(); beam_id++){
+         
+        if (sensor.getMeasurements()(beam_id, 1) < sensor.getRange() &&
+            measurement_estimate(beam_id, 1) < sensor.getRange()){
+            valid_indices.push_back(beam_id);
         }
     }
+
+    if (valid_indices.size() > 0){
+        // Transform measurements to cartesian coordinates
+        Eigen::MatrixX2f measurements_cartesian = polar2cart(pose, sensor.getMeasurements(), valid_indices);
+        
+        // Transform measurements to cartesian coordinates
+        Eigen::MatrixX2f measurement_estimate_cartesian = polar2cart(this->particles.getPose(particle_id), measurement_estimate, valid_indices);
+        
+        // Estimated pose correction using ICP (Iterative Closest Point) matching with the worker's scan matcher
+        Eigen::Vector3f pose_dif = this->scan_matchers[worker_id].ICP(measurement_estimate_cartesian, measurements_cartesian, this->getR());
+        
+        // Update the particle's pose using the estimated pose correction
+        Eigen::Vector3f particle_pose = this->particles.getPose(particle_id) + pose_dif;
+        
+        // Limit heading to range [-pi, pi)
+        particle_pose(2) = fmod((float)particle_pose(2)+PI, 2*PI) - PI;
+        this->particles.setPose(particle_id, particle_pose);
+    }
+}
+
+
+// Align real measurements to a map with the worker's scan-to-map matcher
+template<typename Grid>
+Eigen::Vector3f RBPF::match_grid(const Grid& map, const int& worker_id, const Eigen::Vector3f& pose, Sensor& sensor){
+    
+    if (this->scan_matching_mode == 2){
+        return this->correlative_matchers[worker_id].match(map, pose, sensor.getMeasurements(), sensor.getRange(), this->getR()); }
+    return this->grid_matchers[worker_id].match(map, pose, sensor.getMeasurements(), sensor.getRange(), this->getR());
+}
+
+
+// Collect number of scan matching iterations of all workers in the current step
+void RBPF::count_scan_matching_iterations(){
+    
+    long n_iterations = 0;
+    for (int worker_id = 0; worker_id < (int)this->scan_matchers.size(); worker_id++){
+        n_iterations += this->scan_matchers[worker_id].getNIterations() + this->grid_matchers[worker_id].getNIterations() + this->correlative_matchers[worker_id].getNIterations();
+        this->scan_matchers[worker_id].resetNIterations();
+        this->grid_matchers[worker_id].resetNIterations();
+        this->correlative_matchers[worker_id].resetNIterations();
+    }
+    this->n_scan_matching_iterations += n_iterations;
+    PROFILE_COUNT(CounterScanMatchingIterations, n_iterations);
 }
 
 
@@ -363,7 +473,7 @@ void RBPF::scan_matching(const Eigen::Vector3f &pose, Sensor& sensor){
 // +++++++++++++++++++++++++++++++++++++++++ Improved Propsosal ++++++++++++++++++++++++++++++++++++++++++++++
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-double RBPF::motion_model_velocity(Eigen::Vector3f particle_pose, Eigen::Vector3f sample_pose, Eigen::Vector2f odometry_signal, float current_timestamp){
+double RBPF::motion_model_velocity(Eigen::Vector3f particle_pose, Eigen::Vector3f sample_pose, Eigen::Vector2f odometry_signal, float current_timestamp, RandomStream& random){
     
     float v = odometry_signal(0);
     float omega = odometry_signal(1);
@@ -392,18 +502,15 @@ double RBPF::motion_model_velocity(Eigen::Vector3f particle_pose, Eigen::Vector3
     float v_hat = delta_theta / delta_t * r_star;
     float omega_hat = delta_theta / delta_t;
     
-    // Create standard normal distribution for sampling
-    normal_distribution<float> distribution(0.0, 1.0);
-    
     Eigen::Vector4f a = Eigen::Vector4f::Zero();
     a(0) = 0.1;
     a(1) = 0.02;
     a(2) = 0.02;
     a(3) = 0.1;
     float std_dev_1 = sqrt(a(0)*pow(v, 2)+a(1)*pow(omega, 2));
-    float p1 = (v - v_hat) + std_dev_1 * distribution(engine);
+    float p1 = (v - v_hat) + std_dev_1 * random.normal();
     float std_dev_2 = sqrt(a(2)*pow(v, 2)+a(3)*pow(omega, 2));
-    float p2 = (omega - omega_hat) + std_dev_2 * distribution(engine);
+    float p2 = (omega - omega_hat) + std_dev_2 * random.normal();
 
     float p = p1 * p2;
     
@@ -414,286 +521,250 @@ double RBPF::motion_model_velocity(Eigen::Vector3f particle_pose, Eigen::Vector3
 
 void RBPF::improved_proposal(Sensor &sensor, Eigen::Vector2f odometry_signal, float current_timestamp){
     
-    // Create standard normal distribution for sampling
-    normal_distribution<float> distribution(0.0, 1.0);
+    // Container for unnormalized particle log-weights
+    Eigen::ArrayXd log_weights = Eigen::ArrayXd::Zero(this->particles.size());
     
-    vector<double> weights;
+    // Iterate over all particles in parallel to generate samples around scan-matching pose
+    this->thread_pool->parallel_for(this->particles.size(), [&](int particle_id, int worker_id){
+        log_weights(particle_id) = this->improved_proposal_particle(particle_id, sensor, odometry_signal, current_timestamp);
+    });
     
-    // Iterate over all particles to generate samples around scan-matching pose
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
-        
-        Eigen::Vector3f mu_i = Eigen::Vector3f::Zero();
-        float eta_i = 0.0;
-        vector<float> pis;
-        
-        for (vector<Eigen::Vector3f>::iterator sit = (*it).getSamples().begin(); sit != (*it).getSamples().end(); sit++){
-            
-            (*sit)(0) = (*it).getPose()(0) + this->R(0) * distribution(engine);
-            (*sit)(1) = (*it).getPose()(1) + this->R(1) * distribution(engine);
-            (*sit)(2) = (*it).getPose()(2);
-            
-            // Sample ID
-            int sample_id = (int)distance((*it).getSamples().begin(), sit);
-            
-            // Transform sample pose from world coordinates to map coordinates
-            Eigen::Array3f map_pose = Map::world2map((*sit));
+    // Normalize weights of all particles
+    this->normalize_weights(log_weights);
+}
 
-            // Get mass center of sample's center pixel
-            const float xc_r = (float) map_pose(0) + 0.5;
-            const float yc_r = (float) map_pose(1) + 0.5;
-            const float heading_r = (float) map_pose(2);
-            
-            // Transform sensor's maximum range to map scale
-            int map_range = Map::world2map(sensor.getRange());
-            
-            // Instantiate container for estimated measurements
-            (*it).getSampleMeasurementEstimates()[sample_id] = Eigen::MatrixX2f::Ones(sensor.getN(), 2) * sensor.getRange(); // Initialize measurements to sensor range
-            (*it).getSampleMeasurementEstimates()[sample_id].col(0) = Eigen::ArrayXf::LinSpaced(sensor.getN(), -PI/180*sensor.getFoV()/2, PI/180*sensor.getFoV()/2); // Set angle for each laser beam
-            
-            // Get reference to real laser measurements
-            Eigen::MatrixX2f measurement_ref = sensor.getMeasurements();
-            
-            // Get reference to the currently inspected particle's map data
-            cv::Mat map_ref = (*it).getMap().getData();
+
+// Sample pose of a single particle from the improved proposal and return its updated (unnormalized) log-weight
+double RBPF::improved_proposal_particle(const int& particle_id, Sensor &sensor, Eigen::Vector2f odometry_signal, float current_timestamp){
+    
+    PROFILE_SCOPE(StageImprovedProposal);
+    
+    Eigen::Vector3f mu_i = Eigen::Vector3f::Zero();
+    double eta_i = 0.0;
+    
+    // Per-thread scratch buffers for the samples, their measurement estimates and log-likelihoods, reused across
+    // particles
+    thread_local vector<Eigen::Vector3f> samples;
+    thread_local vector<Eigen::MatrixX2f> sample_measurement_estimates;
+    thread_local vector<double> sample_log_likelihoods;
+    samples.resize(this->n_samples);
+    sample_log_likelihoods.resize(this->n_samples);
+    
+    // Scan-matching pose of the particle
+    const Eigen::Vector3f particle_pose = this->particles.getPose(particle_id);
+    
+    // Draw samples around the scan-matching pose, each sample uses its own random stream
+    for (int sample_id = 0; sample_id < this->n_samples; sample_id++){
+        
+        RandomStream random(this->step, particle_id, sample_id + 1);
+        Eigen::Vector3f& sample = samples[sample_id];
+        sample(0) = particle_pose(0) + this->R(0) * random.normal();
+        sample(1) = particle_pose(1) + this->R(1) * random.normal();
+        sample(2) = particle_pose(2);
+    }
+    
+    // Evaluate the likelihood field for all samples at once, otherwise estimate sensor sweep of all samples in
+    // a single batch on the particle's map and compare it to the real measurements
+    if (this->measurement_model == 1){
+        this->likelihood_field_particle(particle_id, samples, sensor, sample_log_likelihoods);
+    }
+    else {
+        this->cast_particle(particle_id, samples, sensor, sample_measurement_estimates);
+        for (int sample_id = 0; sample_id < this->n_samples; sample_id++){
+            sample_log_likelihoods[sample_id] = RBPF::beam_log_likelihood(sensor.getMeasurements(), sample_measurement_estimates[sample_id], sensor.getQ()(1), sensor.getRange());
+        }
+    }
+    
+    // Compute motion model probability of samples
+    //Eigen::Vector3f last_particle_pose = this->particles.getLastPose(particle_id);
+    //for (int sample_id = 0; sample_id < this->n_samples; sample_id++){
+    //    RandomStream random(this->step, particle_id, sample_id + 1);
+    //    double p1 = motion_model_velocity(last_particle_pose, samples[sample_id], odometry_signal, current_timestamp, random);
+    //    sample_log_likelihoods[sample_id] += log(p1);
+    //}
+    
+    // Likelihoods relative to the most likely sample, so the largest one is 1 and the sum cannot underflow
+    const double max_log_likelihood = *max_element(sample_log_likelihoods.begin(), sample_log_likelihoods.end());
+    if (!isfinite(max_log_likelihood)){
+        return -numeric_limits<double>::infinity();
+    }
+    
+    // Update mean estimate and normalization factor
+    thread_local vector<double> pis;
+    pis.resize(this->n_samples);
+    for (int sample_id = 0; sample_id < this->n_samples; sample_id++){
+        pis[sample_id] = exp(sample_log_likelihoods[sample_id] - max_log_likelihood);
+        mu_i += samples[sample_id] * (float) pis[sample_id];
+        eta_i += pis[sample_id];
+    }
             
-            // Iterate over all vertical pixels within range of the sensor from robot's current position
-            for (int y_px = ((int)map_pose(1) - map_range); y_px <= ((int)(map_pose(1) + map_range)); y_px++) {
-                // Check that index lies within map boundaries
-                if (y_px >= 0 && y_px < (int)(Map::getHeight() / Map::getResolution())) {
-                    
-                    // Get a pointer to the beginning of the currently inspected row to access all relevant
-                    // horizontal pixels
-                    uchar* horizontal_pixel_ptr = map_ref.ptr<uchar>(y_px);
-                    
-                    // Iterate over all horizontal pixels within range of the sensor from robot's current position
-                    for (int x_px = ((int)map_pose(0) - map_range); x_px <= ((int)(map_pose(0) + map_range)); x_px++) {
-                        // Check that index lies within map boundaries
-                        if (x_px >= 0 && x_px < (int)(Map::getWidth() / Map::getResolution())) {
-                        
-                            // Update estimated scan only if occupied cell detected
-                            if (horizontal_pixel_ptr[x_px] < Map::getThreshold()) {
-                                
-                                // Get mass center of currently inspected pixel
-                                const float xc_px = x_px + 0.5;
-                                const float yc_px = y_px + 0.5;
-                                
-                                // Compute relative angles of all corner points of currently inspected pixel
-                                vector<float> pixel_angles;
-                                for (float i = -0.5; i <= 0.5; i+=0.5) {
-                                    for (float j = -0.5; j<= 0.5; j+=0.5) {
-                                        
-                                        // Angle of currently inspected pixel relative to robot's heading
-                                        float pixel_angle = atan2((yc_px+j) - yc_r, (xc_px+i) - xc_r) - heading_r;
-                                        // Keep angle within range [-pi, pi)
-                                        if (pixel_angle < -PI) {
-                                            pixel_angle = fmod(pixel_angle-PI, 2*PI) + PI; }
-                                        else {
-                                            pixel_angle = fmod(pixel_angle+PI, 2*PI) - PI; }
-                                        
-                                        pixel_angles.push_back(pixel_angle);
-                                    }
-                                }
-                                
-                                // Get minimum and maximum relative angle that hits currently inspected pixel
-                                float angle_max = *max_element(pixel_angles.begin(), pixel_angles.end());
-                                float angle_min = *min_element(pixel_angles.begin(), pixel_angles.end());
-                                
-                                // Distance from robot to mass center of currently inspected pixel
-                                const float pixel_distance = sqrt(pow(xc_px - xc_r, 2) + pow(yc_px - yc_r, 2));
-                                
-                                // Find all relevant laser beams
-                                vector <int> valid_ids;
-                                if (angle_min < -PI/2 && angle_max > PI/2) {
-                                    for (int beam_id = 0; beam_id < sensor.getN(); beam_id++) {
-                                        if (measurement_ref(beam_id, 0) <= angle_min && measurement_ref(beam_id, 0) >= angle_max) {
-                                            valid_ids.push_back(beam_id);
-                                        }
-                                    }
-                                }
-                                else {
-                                    for (int beam_id = 0; beam_id < sensor.getN(); beam_id++) {
-                                        if (measurement_ref(beam_id, 0) >= angle_min && measurement_ref(beam_id, 0) <= angle_max) {
-                                            valid_ids.push_back(beam_id);
-                                        }
-                                    }
-                                }
-                                
-                                // Update estimated distance
-                                for (vector<int>::iterator beam_it = valid_ids.begin(); beam_it != valid_ids.end(); beam_it++) {
-                                    if (pixel_distance < Map::world2map((*it).getSampleMeasurementEstimates()[sample_id]((*beam_it), 1))) {
-                                        (*it).getSampleMeasurementEstimates()[sample_id]((*beam_it), 1) = Map::map2world((int)pixel_distance);
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-                
-            // Get reference to estimated measurements
-            Eigen::MatrixX2f sample_measurement_estimate = (*it).getSampleMeasurementEstimates()[sample_id];
+    // Get final estimate of mean pose
+    mu_i /= (float) eta_i;
             
-            vector<int> valid_ids;
-            for (int beam_id = 0; beam_id < sample_measurement_estimate.rows(); beam_id++){
+    // Compute sigma
+    Eigen::Matrix3f sigma_i = Eigen::Matrix3f::Zero();
+    for (int sample_id = 0; sample_id < this->n_samples; sample_id++){
                 
-                if (measurement_ref(beam_id, 1) < sensor.getRange() && sample_measurement_estimate(beam_id, 1) < sensor.getRange()){
-                    valid_ids.push_back(beam_id);
-                }
-            }
-                    
-            // Compute average likelihood of measurements
-            double p = 1.0;
-            for (int beam_id = 0; beam_id < measurement_ref.rows(); beam_id++){
-                        
-                if (std::count(valid_ids.begin(), valid_ids.end(), beam_id)){
-                            
-                    // Get difference between real and estimated measurement
-                    float scan_dif = abs(measurement_ref(beam_id, 1) - sample_measurement_estimate(beam_id, 1));
-                            
-                    // Compute and accumulate likelihood of measurement based on gaussian measurement model
-                    float likelihood = exp(-0.5*pow((scan_dif/sensor.getQ()(1)), 2)) / (sqrt(2*PI) * sensor.getQ()(1));
-                    //float likelihood = exp(-0.5*pow((scan_dif), 2)) / (sqrt(2*PI));
-                            
-                    // Update likelihood
-                    p *= likelihood;
-                }
-            }
+        sigma_i += (samples[sample_id] - mu_i)*(samples[sample_id] - mu_i).transpose() * (float) pis[sample_id];
+    }
             
-            // Compute motion model probability of sample
-            Eigen::Vector3f last_particle_pose = (*it).getLastPose();
-            //double p1 = motion_model_velocity(last_particle_pose, (*sit), odometry_signal, current_timestamp);
-            //p *= p1;
+    // Get final estimate of sigma
+    sigma_i /= (float) eta_i;
             
-            // Update mean estimate and normalization factor
-            mu_i += (*sit) * p;
-            eta_i += p;
-            pis.push_back(p);
-        }
-                
-        // Get final estimate of mean pose
-        mu_i /= eta_i;
-                
-        // Compute sigma
-        Eigen::Matrix3f sigma_i = Eigen::Matrix3f::Zero();
-        for (vector<Eigen::Vector3f>::iterator sit = (*it).getSamples().begin(); sit != (*it).getSamples().end(); sit++){
-                    
-            int sample_id = (int)distance((*it).getSamples().begin(), sit);
-            sigma_i += ((*sit) - mu_i)*((*sit) - mu_i).transpose() * pis[sample_id];
-        }
-                
-        // Get final estimate of sigma
-        sigma_i /= eta_i;
-                
-        // Sample final particle pose
-        if (eta_i > 1e-40){
-            Eigen::Vector3f final_pose;
-            final_pose(0) = mu_i(0) + sigma_i(0, 0) * distribution(engine);
-            final_pose(1) = mu_i(1) + sigma_i(1, 1) * distribution(engine);
-            final_pose(2) = (*it).getPose()(2);
-            (*it).getPose() = final_pose;
-                    
-            // Update particle weight
-            weights.push_back((*it).getWeight() * eta_i);
-        }
-        else {
-            weights.push_back(0.0);
-        }
-                
-    }
+    // Sample final particle pose
+    RandomStream random(this->step, particle_id, this->n_samples + 1);
+    Eigen::Vector3f final_pose;
+    final_pose(0) = mu_i(0) + sigma_i(0, 0) * random.normal();
+    final_pose(1) = mu_i(1) + sigma_i(1, 1) * random.normal();
+    final_pose(2) = particle_pose(2);
+    this->particles.setPose(particle_id, final_pose);
+    
+    // Update particle log-weight with the log of the normalization factor
+    return log(this->particles.getWeight(particle_id)) + max_log_likelihood + log(eta_i);
+}
+
+
+// Normalize weights to a sum of 1 given their logarithms (log-sum-exp)
+void RBPF::normalize_weights(const Eigen::ArrayXd& log_weights){
     
-    // Accumulate weights of all particles
-    double sum_of_weights = std::accumulate(weights.begin(), weights.end(), 0.0);
+    // Shift log-weights by their maximum, so the largest weight is 1 and the sum cannot underflow
+    const double max_log_weight = log_weights.maxCoeff();
     
-    // If sum of weights close to 0, don't update weights
-    if (sum_of_weights < 1e-40){
+    // If all weights are 0, don't update weights
+    if (!isfinite(max_log_weight)){
         cout << "Sum of Weights = 0" << endl;
     }
     // Normalize weights to a sum of 1
     else {
-        cout << "Weights: " << endl;
-        for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
-            (*it).getWeight() = weights[(int)distance(particles.begin(), it)] / sum_of_weights;
-            cout << (*it).getWeight() << endl;
-        }
+        const Eigen::ArrayXd weights = (log_weights - max_log_weight).exp();
+        this->particles.getWeights() = weights / weights.sum();
+        if (this->verbose == 2){
+            cout << "Weights: " << endl;
+            cout << this->particles.getWeights() << endl;}
     }
 }
 
 
+
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // ++++++++++++++++++++++++++++++++++++++++++++++ Weighting ++++++++++++++++++++++++++++++++++++++++++++++++++
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 void RBPF::weight(Sensor &sensor){
     
-    // Get reference to current measurements
-    Eigen::MatrixX2f measurement_ref = sensor.getMeasurements();
+    // Instantiate container for log-weights
+    Eigen::ArrayXd log_weights = Eigen::ArrayXd::Zero(this->particles.size());
+    
+    // Iterate over all particles in parallel
+    this->thread_pool->parallel_for(this->particles.size(), [&](int particle_id, int worker_id){
+        log_weights(particle_id) = this->weight_particle(particle_id, sensor);
+    });
+    
+    // Normalize weights of all particles
+    this->normalize_weights(log_weights);
+}
+
+
+// Compute updated (unnormalized) log-weight of a single particle
+double RBPF::weight_particle(const int& particle_id, Sensor &sensor){
     
-    // Instantiate container for weights
-    vector<double> weights;
+    PROFILE_SCOPE(StageWeight);
     
-    // Instantiate container for valid beam IDs
-    vector<int> valid_beam_ids;
+    double log_likelihood;
     
-    // Factor by which to multiply sensor range to classify outlier
-    float outlier_factor = 0.12;
+    // Evaluate the likelihood field at the particle's pose
+    if (this->measurement_model == 1){
+        thread_local vector<Eigen::Vector3f> poses(1);
+        thread_local vector<double> log_likelihoods;
+        poses[0] = this->particles.getPose(particle_id);
+        this->likelihood_field_particle(particle_id, poses, sensor, log_likelihoods);
+        log_likelihood = log_likelihoods[0];
+    }
+    // Compare the real measurements of all beams to the estimated ones
+    else {
+        log_likelihood = RBPF::beam_log_likelihood(sensor.getMeasurements(), this->particles.getMeasurementEstimate(particle_id), sensor.getQ()(1), numeric_limits<float>::infinity());
+    }
     
-    // Iterate over all particles
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
-        
-        // Get reference to estimated measurements
-        Eigen::MatrixX2f measurement_estimate = (*it).getMeasurementEstimate();
+    // Return updated log-weight
+    return log(this->particles.getWeight(particle_id)) + log_likelihood;
+}
+
+
+// Log-likelihood of the measurements given the estimated measurements under a gaussian measurement model with
+// standard deviation sigma. Beams whose measured or estimated range is at least max_range are ignored.
+double RBPF::beam_log_likelihood(const Eigen::MatrixX2f& measurements, const Eigen::MatrixX2f& measurement_estimate, const float& sigma, const float& max_range){
+    
+    const auto ranges = measurements.col(1).array();
+    const auto estimated_ranges = measurement_estimate.col(1).array();
+    
+    // Mask of the beams that are taken into account
+    const Eigen::ArrayXf valid = ((ranges < max_range) && (estimated_ranges < max_range)).cast<float>();
+    
+    // Sum of the gaussian log-likelihoods of all valid beams
+    const float log_normalization = log(sqrt(2 * PI) * sigma);
+    const float squared_error_sum = (valid * ((ranges - estimated_ranges) / sigma).square()).sum();
+    return -0.5 * squared_error_sum - valid.sum() * log_normalization;
+}
+
+
+// Log-likelihood of the measurements for each of the poses under the likelihood field model of the particle's map.
+// Each beam endpoint is scored by a gaussian of its distance to the nearest obstacle mixed with a uniform
+// distribution of random measurements. Beams at maximum range are ignored.
+void RBPF::likelihood_field_particle(const int& particle_id, const vector<Eigen::Vector3f>& poses, Sensor& sensor, vector<double>& log_likelihoods){
+    
+    const LikelihoodField& field = this->particles.getLikelihoodField(particle_id);
+    const Eigen::MatrixX2f& measurements = sensor.getMeasurements();
+    const float range = sensor.getRange();
+    
+    // Scale from world coordinates to map coordinates
+    const float scale_x = Map::getWidth() / Map::getResolution() / (Map::getXMax() - Map::getXMin());
+    const float scale_y = Map::getHeight() / Map::getResolution() / (Map::getYMax() - Map::getYMin());
+    
+    // Gaussian of the endpoint distance in cells, the standard deviation is the range uncertainty
+    const float sigma = sensor.getQ()(0) * scale_x;
+    const float normalization = Z_HIT / (sqrt(2 * PI) * sensor.getQ()(0));
+    const float p_random = Z_RANDOM / range;
+    
+    // Endpoint offsets of the beams in map coordinates, recomputed only when the heading changes
+    thread_local vector<float> offsets_x, offsets_y;
+    offsets_x.resize(measurements.rows());
+    offsets_y.resize(measurements.rows());
+    float offsets_theta = NAN;
+    
+    log_likelihoods.resize(poses.size());
+    for (int pose_id = 0; pose_id < (int)poses.size(); pose_id++){
         
-        for (int beam_id = 0; beam_id < measurement_ref.rows(); beam_id++){
-            
-            if (abs(measurement_ref(beam_id, 1) - measurement_estimate(beam_id, 1)) < sensor.getRange() * outlier_factor){
-                valid_beam_ids.push_back(beam_id);
+        const Eigen::Vector3f& pose = poses[pose_id];
+        if (!(pose(2) == offsets_theta)){
+            for (int beam_id = 0; beam_id < measurements.rows(); beam_id++){
+                const float angle = pose(2) + measurements(beam_id, 0);
+                offsets_x[beam_id] = measurements(beam_id, 1) * cos(angle) * scale_x;
+                offsets_y[beam_id] = measurements(beam_id, 1) * sin(angle) * scale_y;
             }
+            offsets_theta = pose(2);
         }
-    }
-    
-    // Iterate over all particles
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
         
-        // Get reference to estimated measurements
-        Eigen::MatrixX2f measurement_estimate = (*it).getMeasurementEstimate();
+        // Sensor position in map coordinates
+        const float x_map = (pose(0) - Map::getXMin()) * scale_x;
+        const float y_map = (pose(1) - Map::getYMin()) * scale_y;
         
-        // Compute average likelihood of measurements
-        double p = 1.0;
-        int downsample_factor = 1;
-        for (int beam_id = 0; beam_id < measurement_ref.rows(); beam_id++){
+        double log_p = 0.0;
+        for (int beam_id = 0; beam_id < measurements.rows(); beam_id++){
             
-            if (beam_id % downsample_factor == 0){
-                
-                // Get difference between real and estimated measurement
-                float scan_dif = abs(measurement_ref(beam_id, 1) - measurement_estimate(beam_id, 1));
-                
-                // Compute and accumulate likelihood of measurement based on gaussian measurement model
-                float likelihood = exp(-0.5*pow((scan_dif/sensor.getQ()(1)), 2)) / (sqrt(2*PI) * sensor.getQ()(1));
-                
-                // Update likelihood
-                p *= likelihood;
+            if (measurements(beam_id, 1) >= range){
+                continue; }
+            
+            // Distance of the endpoint to the nearest obstacle, endpoints outside the map are far from all obstacles
+            const int x_px = (int) floor(x_map + offsets_x[beam_id]);
+            const int y_px = (int) floor(y_map + offsets_y[beam_id]);
+            float distance = (float) LikelihoodField::getMaxDistance();
+            if (x_px >= 0 && y_px >= 0 && x_px < field.getCols() && y_px < field.getRows()){
+                distance = field.getDistance(x_px, y_px);
             }
+            
+            log_p += log(normalization * exp(-0.5f * (distance / sigma) * (distance / sigma)) + p_random);
         }
-        
-        // Update weight and append to weight vector
-        double new_weight = (*it).getWeight() * p;
-        weights.push_back(new_weight);
-    }
-    
-    // Accumulate weights of all particles
-    double sum_of_weights = std::accumulate(weights.begin(), weights.end(), 0.0);
-    
-    // If sum of weights close to 0, don't update weights
-    if (sum_of_weights < 1e-40){
-        cout << "Sum of Weights = 0" << endl;
-    }
-    // Normalize weights to a sum of 1
-    else {
-        cout << "Weights: " << endl;
-        for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
-            (*it).getWeight() = weights[(int)distance(particles.begin(), it)] / sum_of_weights;
-            cout << (*it).getWeight() << endl;
-        }
+        log_likelihoods[pose_id] = log_p;
     }
 }
 
@@ -704,60 +775,108 @@ void RBPF::weight(Sensor &sensor){
 
 void RBPF::resample(){
     
-    // Create standard normal distribution for sampling
-    uniform_real_distribution<float> distribution(0.0, 1.0);
+    PROFILE_SCOPE(StageResampling);
+    PROFILE_COUNT(CounterResampleEvents, 1);
     
-    // Instantiate containers for cumulative sum of weights and particle poses
-    vector<float> cum_sum;
-    vector<Eigen::Array3f> poses;
-    vector<cv::Mat> maps;
+    // Random stream of the resampling step
+    RandomStream random(this->step, RESAMPLING_STREAM, 0);
     
-    // Initialize sum of weights to 0
-    float sum = 0;
+    // Number of particles before resampling
+    const int n_particles = this->particles.size();
     
-    // Iterate over all particles, accumulate weights and append poses
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
-        sum += (float)(*it).getWeight();
-        cum_sum.push_back(sum);
-        poses.push_back((*it).getPose());
-        maps.push_back((*it).getMap().getDataCopy());
+    // Number of particles after resampling
+    if (this->kld_sampling == 1){
+        
+        // Accumulate weights of all particles
+        vector<float> cum_sum(n_particles);
+        float sum = 0;
+        for (int particle_id = 0; particle_id < n_particles; particle_id++) {
+            sum += (float)this->particles.getWeight(particle_id);
+            cum_sum[particle_id] = sum;
+        }
+        
+        this->n_particles = this->kld_particle_count(cum_sum, random);
     }
     
-    // +++++++++++++++++++++++++++++++ Perform systematic resampling +++++++++++++++++++++++++++++++++++++++++
+    // Draw ancestors of the next generation, surviving particles keep their slot
+    const vector<int>& ancestor_ids = this->resampler.resample(this->particles.getWeights(), this->n_particles, random);
     
-    // Sample random number in range [0, 1/N]
-    float r = distribution(engine) / this->n_particles;
+    // Last slot of each ancestor that has no slot of its own in the next generation, it can be moved there
+    vector<int> last_slot_ids(n_particles, -1);
+    for (int particle_id = 0; particle_id < this->n_particles; particle_id++) {
+        if (ancestor_ids[particle_id] >= this->n_particles) {
+            last_slot_ids[ancestor_ids[particle_id]] = particle_id; }
+    }
     
-    // Instantiate container
-    vector<int> particle_ids;
+    // Slots added to a growing set are filled with copies of their ancestors. All ancestors keep their own slot
+    // in a growing set, so they are not overwritten below.
+    if (this->n_particles > n_particles) {
+        this->particles.appendCopies(vector<int>(ancestor_ids.begin() + n_particles, ancestor_ids.begin() + this->n_particles)); }
     
-    // Iterate over all particles
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
+    // Overwrite slots of particles without offspring with their new ancestors. Ancestors either keep their own
+    // slot or have none in the next generation, so no ancestor is overwritten before all its copies are made.
+    // Copying a map only shares its tiles, tiles are cloned on the first write during mapping.
+    for (int particle_id = 0; particle_id < min(n_particles, this->n_particles); particle_id++) {
         
-        // Get reference threshold for particle sampling
-        float ref_sum = r + ((float)distance(this->particles.begin(), it) / this->n_particles);
+        const int ancestor_id = ancestor_ids[particle_id];
+        if (ancestor_id == particle_id) {
+            continue; }
         
-        // Select index of first particle for which cumulative sum exceeds reference threshold
-        for (vector<float>::iterator sit = cum_sum.begin(); sit != cum_sum.end(); sit++) {
-            if ((*sit) >= ref_sum) {
-                int particle_id = (int) distance(cum_sum.begin(), sit);
-                particle_ids.push_back(particle_id);
-                break;
-            }
-        }
+        if (last_slot_ids[ancestor_id] == particle_id) {
+            this->particles.moveParticle(ancestor_id, particle_id); }
+        else {
+            this->particles.copyParticle(ancestor_id, particle_id); }
     }
+    this->particles.truncate(this->n_particles);
     
-    // Resample particles based on selected IDs
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
+    // Particles inherit the ancestry of the sampled particles
+    if (this->map_representation == 1){
+        this->ancestry_map->resample(ancestor_ids);
+    }
+    
+    // Reset weights of all particles to 1/N
+    this->particles.getWeights().setConstant(1.0 / this->n_particles);
+}
+
+
+// Draw particles according to their weights until the number of drawn particles bounds the KL divergence between
+// the sample-based and the true posterior by epsilon with probability 1 - delta (Fox, KLD-sampling). The posterior
+// is discretized into a histogram over the poses, the bound grows with the number of occupied bins.
+int RBPF::kld_particle_count(const vector<float>& cum_sum, RandomStream& random){
+    
+    const int n_particles = (int) cum_sum.size();
+    
+    // Occupied bins, each bin is identified by its indices packed into a single key
+    unordered_set<int64_t> bins;
+    const int64_t mask = (1 << 21) - 1;
+    
+    int n_drawn = 0;
+    int n_required = this->n_particles_min;
+    while (n_drawn < this->n_particles_max && (n_drawn < this->n_particles_min || n_drawn < n_required)) {
         
-        // Get ID of sampled particle and assign corresponding pose
-        int particle_id = particle_ids[(int)distance(this->particles.begin(), it)];
-        (*it).getPose() = poses[particle_id];
-        (*it).getMap().setData(maps[particle_id]);
+        // Draw particle proportional to its weight
+        const float u = random.uniform() * cum_sum.back();
+        const int particle_id = min((int) (lower_bound(cum_sum.begin(), cum_sum.end(), u) - cum_sum.begin()), n_particles - 1);
+        n_drawn++;
         
-        // Reset weight of particle to 1/N
-        (*it).getWeight() = 1.0 / this->n_particles;
+        // Bin of the particle's pose, heading is wrapped to [0, 2 PI)
+        const Eigen::Vector3f pose = this->particles.getPose(particle_id);
+        const float theta = pose(2) - 2 * PI * floor(pose(2) / (2 * PI));
+        const int64_t bin_x = (int64_t) floor(pose(0) / this->kld_bin_size_xy);
+        const int64_t bin_y = (int64_t) floor(pose(1) / this->kld_bin_size_xy);
+        const int64_t bin_theta = (int64_t) floor(theta / this->kld_bin_size_theta);
+        const int64_t key = ((bin_x & mask) << 42) | ((bin_y & mask) << 21) | (bin_theta & mask);
+        
+        // Update required number of particles if the particle falls into an empty bin (Wilson-Hilferty
+        // approximation of the chi-square quantile with k - 1 degrees of freedom)
+        if (bins.insert(key).second && bins.size() > 1) {
+            const float k = (float) bins.size() - 1;
+            const float a = 2.0f / (9.0f * k);
+            n_required = (int) ceil(k / (2 * this->kld_epsilon) * pow(1 - a + sqrt(a) * this->kld_z, 3));
+        }
     }
+    
+    return n_drawn;
 }
 
 
@@ -772,43 +891,48 @@ int RBPF::inverse_sensor_model(const int &x_px, const int &y_px, Eigen::Vector3f
     int occupancy_update;
     
     // Inverse model parameters
-    const float alpha = 1.0; // thickness of object in map coordinates
-    const float beta = 0.1; // width of a laser beam in map coordinates
+    const float alpha = OBJECT_THICKNESS; // thickness of object in map coordinates
+    const float beta = BEAM_WIDTH; // width of a laser beam in map coordinates
     const float max_range = Map::world2map(sensor.getRange());
     
-    // Get mass center of currently inspected pixel
-    const float xc_px = x_px + 0.5;
-    const float yc_px = y_px + 0.5;
-    
-    // Get mass center of robot's center pixel
-    const float xc_r = (float)map_pose(0) + 0.5;
-    const float yc_r = (float)map_pose(1) + 0.5;
+    // Offset of currently inspected pixel from robot's center pixel
+    const int dx = x_px - (int)map_pose(0);
+    const int dy = y_px - (int)map_pose(1);
     const float heading_r = (float)map_pose(2);
     
     // Distance from robot to mass center of currently inspected pixel
-    const float pixel_distance = sqrt(pow(xc_px - xc_r, 2) + pow(yc_px - yc_r, 2));
+    const float pixel_distance = this->polar_table.getDistance(dx, dy);
     
     // Angle of currently inspected pixel relative to robot's heading
-    float pixel_angle = atan2(yc_px - yc_r, xc_px - xc_r) - heading_r;
+    float pixel_angle = this->polar_table.getAngle(dx, dy) - heading_r;
     // Keep angle within range [-pi, pi)
     if (pixel_angle < -PI) {
         pixel_angle = fmod(pixel_angle-PI, 2*PI) + PI; }
     else {
         pixel_angle = fmod(pixel_angle+PI, 2*PI) - PI; }
 
-    // Check if inspected pixel lies in sensor's FoV
-    if (pixel_angle < -((float)sensor.getFoV()/360.0*PI) || pixel_angle > ((float)sensor.getFoV()/360*PI)) {
+    // Check if inspected pixel lies in sensor's FoV, i.e. between the first and the last beam
+    const double first_beam_angle = sensor.getStartAngle() / 180.0 * PI;
+    const double last_beam_angle = (sensor.getStartAngle() + sensor.getFoV()) / 180.0 * PI;
+    if (pixel_angle < first_beam_angle || pixel_angle > last_beam_angle) {
         return occupancy_update = 0; }
     else {
     
-        // Select laser beam with the minimum angle difference to the calculated pixel angle
-        vector<float> angle_dif;
-        for(int beam_id = 0; beam_id < sensor.getN(); beam_id++) {
-            angle_dif.push_back(abs(pixel_angle - sensor.getMeasurements()(beam_id, 0)));
+        // Select laser beam with the minimum angle difference to the calculated pixel angle. Beams are evenly
+        // spaced, so the closest beam follows from the angle offset to the first beam. Neighbors are checked
+        // to resolve rounding at the midpoint between two beams.
+        const Eigen::MatrixX2f& measurements = sensor.getMeasurements();
+        const int n_beams = sensor.getN();
+        int beam_id = 0;
+        if (n_beams > 1) {
+            const float beam_spacing = measurements(1, 0) - measurements(0, 0);
+            const int nearest_beam_id = min(max((int)round((pixel_angle - measurements(0, 0)) / beam_spacing), 0), n_beams - 1);
+            beam_id = max(nearest_beam_id - 1, 0);
+            for (int neighbor_id = beam_id + 1; neighbor_id <= min(nearest_beam_id + 1, n_beams - 1); neighbor_id++) {
+                if (abs(pixel_angle - measurements(neighbor_id, 0)) < abs(pixel_angle - measurements(beam_id, 0))) {
+                    beam_id = neighbor_id; }
+            }
         }
-        
-        // Index of selected measurement
-        int beam_id = (int) distance(angle_dif.begin(), min_element(angle_dif.begin(), angle_dif.end()));
     
         // Get corresponding range and relative angle of the selected measurement
         int detected_range = Map::world2map(sensor.getMeasurements()(beam_id, 1));
@@ -838,44 +962,188 @@ int RBPF::inverse_sensor_model(const int &x_px, const int &y_px, Eigen::Vector3f
 
 // Occupancy grid mapping
 void RBPF::mapping(Sensor &sensor){
+    
+    PROFILE_SCOPE(StageMapping);
+    
+    // Update lookup table of the inverse sensor model if sensor or map parameters changed
+    if (this->mapping_mode == 0){
+        this->polar_table.update(sensor);
+    }
+    
+    // Give each particle its own node of the ancestry tree for the observations of the current step
+    if (this->map_representation == 1){
+        this->ancestry_map->branch();
+    }
+    
+    // Iterate over all particles in parallel
+    this->thread_pool->parallel_for(this->particles.size(), [&](int particle_id, int worker_id){
+        this->mapping_particle(particle_id, sensor);
+    });
+    
+    // Update likelihood fields around the mapped area once all particles wrote their observations
+    if (this->measurement_model == 1){
+        this->thread_pool->parallel_for(this->particles.size(), [&](int particle_id, int worker_id){
+            this->update_likelihood_field_particle(particle_id, sensor);
+        });
+    }
+}
+
+
+// Update the likelihood field of a single particle within the region written by the last mapping step. The
+// particle's own map tracks the cells it wrote, the ancestry map is updated within range of the sensor.
+void RBPF::update_likelihood_field_particle(const int& particle_id, Sensor& sensor){
+    
+    PROFILE_SCOPE(StageLikelihoodField);
+    
+    if (this->map_representation == 1){
+        const int map_range = Map::world2map(sensor.getRange());
+        const Eigen::Vector3f map_pose = Map::world2map(this->particles.getPose(particle_id));
+        const int x_start = (int)map_pose(0) - map_range;
+        const int x_end = (int)map_pose(0) + map_range;
+        const int y_start = (int)map_pose(1) - map_range;
+        const int y_end = (int)map_pose(1) + map_range;
+        
+        const AncestryMap::View view(*this->ancestry_map, particle_id);
+        this->particles.getLikelihoodField(particle_id).update(view, x_start, y_start, x_end, y_end);
+    }
+    else {
+        const Map& map = this->particles.getMap(particle_id);
+        int x_start, y_start, x_end, y_end;
+        if (map.getDirtyRegion(x_start, y_start, x_end, y_end)){
+            this->particles.getLikelihoodField(particle_id).update(map, x_start, y_start, x_end, y_end);
+        }
+    }
+}
+
+
+// Compute the likelihood field of the whole initial map. All particles start with the same map, so the field of
+// the first particle is shared with all others.
+void RBPF::initialize_likelihood_fields(){
+    
+    LikelihoodField& field = this->particles.getLikelihoodField(0);
+    if (this->map_representation == 1){
+        const AncestryMap::View view(*this->ancestry_map, 0);
+        field.update(view, 0, 0, view.getCols() - 1, view.getRows() - 1);
+    }
+    else {
+        const Map& map = this->particles.getMap(0);
+        field.update(map, 0, 0, map.getCols() - 1, map.getRows() - 1);
+    }
+    
+    for (int particle_id = 1; particle_id < this->particles.size(); particle_id++){
+        this->particles.getLikelihoodField(particle_id) = field;
+    }
+}
+
+
+// Occupancy grid mapping for a single particle
+void RBPF::mapping_particle(const int& particle_id, Sensor &sensor){
    
     // Transform the sensor's maximum range to map scale
     int map_range = Map::world2map(sensor.getRange());
+        
+    // Transform particle pose from world coordinates to map coordinates
+    Eigen::Vector3f map_pose = Map::world2map(this->particles.getPose(particle_id));
+    
+    // Get reference to the currently inspected particle's map
+    Map& map = this->particles.getMap(particle_id);
     
-    // Iterate over all particles
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
+    // Pixels within range of the sensor from robot's current position, limited to the map boundaries
+    const int x_start = max((int)map_pose(0) - map_range, 0);
+    const int x_end = min((int)(map_pose(0) + map_range), map.getCols() - 1);
+    const int y_start = max((int)map_pose(1) - map_range, 0);
+    const int y_end = min((int)(map_pose(1) + map_range), map.getRows() - 1);
+    
+    // Dirty region of the map only covers the cells written in this step
+    if (this->map_representation == 0){
+        map.clearDirty();
+    }
+    
+    // Trace measured beams and only update cells along them
+    if (this->mapping_mode == 1){
         
-        // Transform particle pose from world coordinates to map coordinates
-        Eigen::Vector3f map_pose = Map::world2map((*it).getPose());
+        // Get updates of all cells along the beams, sorted by rows
+        const vector<CellUpdate>& cell_updates = this->trace_beams(map_pose, sensor);
+        PROFILE_COUNT(CounterMappedCells, (long) cell_updates.size());
         
-        // Get reference to the currently inspected particle's map data
-        cv::Mat map_ref = (*it).getMap().getData();
+        // Write observations to the particle's node of the shared ancestry map
+        if (this->map_representation == 1){
+            
+            const AncestryMap::View view(*this->ancestry_map, particle_id);
+            
+            // Lock each row of the grid while its cells are updated
+            int locked_row = -1;
+            unique_lock<mutex> lock;
+            for (vector<CellUpdate>::const_iterator it = cell_updates.begin(); it != cell_updates.end(); it++) {
+                if ((*it).y_px != locked_row) {
+                    lock = unique_lock<mutex>(this->ancestry_map->getRowMutex((*it).y_px));
+                    locked_row = (*it).y_px;
+                }
+                this->ancestry_map->update(view, (*it).x_px, (*it).y_px, (*it).occupancy_update);
+            }
+        }
+        // Write to the particle's own map
+        else {
+            for (vector<CellUpdate>::const_iterator it = cell_updates.begin(); it != cell_updates.end(); it++) {
+                map.update((*it).x_px, (*it).y_px, (*it).occupancy_update);
+            }
+        }
+        return;
+    }
+    
+    // Apply the inverse sensor model to all cells within range
+    PROFILE_COUNT(CounterMappedCells, (long) (x_end - x_start + 1) * (y_end - y_start + 1));
+    
+    // Write observations to the particle's node of the shared ancestry map
+    if (this->map_representation == 1){
         
-        // Iterate over all vertical pixels within range of the sensor from robot's current position
-        for (int y_px = ((int)map_pose(1) - map_range); y_px <= ((int)(map_pose(1) + map_range)); y_px++) {
-            // check that index lies within map boundaries
-            if (y_px >= 0 && y_px < (int)(Map::getHeight() / Map::getResolution())) {
+        const AncestryMap::View view(*this->ancestry_map, particle_id);
+        
+        // Iterate over all vertical pixels within range of the sensor, rows are shared with other particles
+        for (int y_px = y_start; y_px <= y_end; y_px++) {
+            lock_guard<mutex> lock(this->ancestry_map->getRowMutex(y_px));
+            
+            // Iterate over all horizontal pixels within range of the sensor
+            for (int x_px = x_start; x_px <= x_end; x_px++) {
                 
-                // Get a pointer to the beginning of the currently inspected row to access all relevant
-                // horizontal pixels
-                uchar* horizontal_pixel_ptr = map_ref.ptr<uchar>(y_px);
+                // Get occupancy information from map for currently inspected pixel and update map
+                int occupancy_update = this->inverse_sensor_model(x_px, y_px, map_pose, sensor);
+                this->ancestry_map->update(view, x_px, y_px, occupancy_update);
+            }
+        }
+        return;
+    }
+    
+    // Tile dimensions
+    const int tile_size = Map::getTileSize();
+    const int tile_bits = Map::getTileBits();
+    
+    // All cells within range are written
+    map.markDirty(x_start, y_start, x_end, y_end);
+    
+    // Iterate over all tiles overlapping the sensor's range. Tiles shared with other particles' maps are
+    // cloned before they are written to.
+    for (int tile_y = (y_start >> tile_bits); tile_y <= (y_end >> tile_bits); tile_y++) {
+        for (int tile_x = (x_start >> tile_bits); tile_x <= (x_end >> tile_bits); tile_x++) {
+            
+            uchar* tile_ptr = map.getWritableTileData(tile_x, tile_y);
+            
+            // Iterate over all vertical pixels of the tile within range of the sensor
+            for (int y_px = max(y_start, tile_y * tile_size); y_px <= min(y_end, (tile_y + 1) * tile_size - 1); y_px++) {
+                
+                // Get a pointer to the beginning of the currently inspected row of the tile to access all
+                // relevant horizontal pixels
+                uchar* horizontal_pixel_ptr = tile_ptr + (y_px - tile_y * tile_size) * tile_size;
                 
-                // Iterate over all horizontal pixels within range of the sensor from robot's current position
-                for (int x_px = ((int)map_pose(0) - map_range); x_px <= ((int)(map_pose(0) + map_range)); x_px++) {
-                    // Check that index lies within map boundaries
-                    if (x_px >= 0 && x_px < (int)(Map::getHeight() / Map::getResolution())) {
-                        
-                        // Get occupancy information from map for currently inspected pixel
-                        float occupancy_update = this->inverse_sensor_model(x_px, y_px, map_pose, sensor);
-                        
-                        // Update map with new occupancy information
-                        // Keep values within range of specified values in case maximum or minimum is reached
-                        if (horizontal_pixel_ptr[x_px] >= (Map::getValueMax() - Map::getValueStep())) {
-                            horizontal_pixel_ptr[x_px] = Map::getValueMax(); }
-                        else if (horizontal_pixel_ptr[x_px] <= Map::getValueStep()) {
-                            horizontal_pixel_ptr[x_px] = Map::getValueMin(); }
-                        else { horizontal_pixel_ptr[x_px] += occupancy_update; }
-                    }
+                // Iterate over all horizontal pixels of the tile within range of the sensor
+                for (int x_px = max(x_start, tile_x * tile_size); x_px <= min(x_end, (tile_x + 1) * tile_size - 1); x_px++) {
+                    
+                    // Get occupancy information from map for currently inspected pixel
+                    int occupancy_update = this->inverse_sensor_model(x_px, y_px, map_pose, sensor);
+                    
+                    // Update map with new occupancy information
+                    uchar& value = horizontal_pixel_ptr[x_px - tile_x * tile_size];
+                    value = Map::updateValue(value, occupancy_update);
                 }
             }
         }
@@ -883,6 +1151,79 @@ void RBPF::mapping(Sensor &sensor){
 }
 
 
+// Trace all measured beams through the grid and collect the occupancy update of each cell along them. Cells up
+// to the detected range are free, the cell of the beam's endpoint is occupied. A cell hit by several beams is
+// updated once and an occupied detection wins over a free one. Cells are returned sorted by rows.
+const vector<CellUpdate>& RBPF::trace_beams(const Eigen::Vector3f& map_pose, Sensor& sensor){
+    
+    // Per-thread buffers reused across particles
+    thread_local vector<uchar> cell_states; // 0 -> not visited, 1 -> free, 2 -> occupied
+    thread_local vector<int> visited_cells;
+    thread_local vector<CellUpdate> cell_updates;
+    
+    // Robot's cell and sensor's maximum range in map coordinates
+    const int x_r = (int) map_pose(0);
+    const int y_r = (int) map_pose(1);
+    const float heading_r = (float) map_pose(2);
+    const float max_range = Map::world2map(sensor.getRange());
+    
+    // Beams only visit cells within range, use a window around the robot to mark visited cells
+    const int map_range = (int) max_range;
+    const int window_size = 2 * map_range + 1;
+    if ((int) cell_states.size() < window_size * window_size) {
+        cell_states.assign(window_size * window_size, 0);
+    }
+    visited_cells.clear();
+    
+    // Grid dimensions
+    const int width = this->particles.getMap(0).getCols();
+    const int height = this->particles.getMap(0).getRows();
+    
+    // Iterate over all laser beams
+    const Eigen::MatrixX2f& measurements = sensor.getMeasurements();
+    for (int beam_id = 0; beam_id < measurements.rows(); beam_id++) {
+        
+        // Detected range and farthest cell of the beam
+        const int detected_range = Map::world2map(measurements(beam_id, 1));
+        const bool object_detected = detected_range < max_range;
+        const float max_distance = min(max_range, detected_range + OBJECT_THICKNESS/2);
+        
+        RayCaster::traverse(x_r, y_r, heading_r + measurements(beam_id, 0), max_distance + 1, width, height,
+                            [&](const int& x_px, const int& y_px, const float& cell_distance){
+            
+            // First cell beyond the free part of the beam is occupied if an object was detected
+            const bool occupied = object_detected && cell_distance > detected_range - OBJECT_THICKNESS/2;
+            if (!occupied && cell_distance >= max_distance) {
+                return false; }
+            
+            // Mark cell, occupied detections win over free ones
+            const int window_id = (y_px - y_r + map_range) * window_size + (x_px - x_r + map_range);
+            if (cell_states[window_id] == 0) {
+                visited_cells.push_back(window_id); }
+            cell_states[window_id] = max(cell_states[window_id], (uchar)(occupied ? 2 : 1));
+            
+            return !occupied;
+        });
+    }
+    
+    // Sort visited cells by rows and convert marks to occupancy updates
+    sort(visited_cells.begin(), visited_cells.end());
+    cell_updates.clear();
+    for (vector<int>::iterator it = visited_cells.begin(); it != visited_cells.end(); it++) {
+        CellUpdate cell_update;
+        cell_update.x_px = x_r - map_range + (*it) % window_size;
+        cell_update.y_px = y_r - map_range + (*it) / window_size;
+        cell_update.occupancy_update = (cell_states[*it] == 2) ? -Map::getValueStep() : Map::getValueStep();
+        cell_updates.push_back(cell_update);
+        
+        // Reset mark for the next particle
+        cell_states[*it] = 0;
+    }
+    
+    return cell_updates;
+}
+
+
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // +++++++++++++++++++++++++++++++++++++++++++++ Get Estimates +++++++++++++++++++++++++++++++++++++++++++++++
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -890,21 +1231,13 @@ void RBPF::mapping(Sensor &sensor){
 // Get current best map estimate
 Map& RBPF::getMap(){
     
-    // Instantiate pointer and set initial best weight to 0
-    Particle* best_particle_ptr = &(*this->particles.begin());
-    float best_particle_weight = 0.0;
-    
-    // Iterate over all particles
-    for (list<Particle>::iterator it = this->particles.begin(); it != this->particles.end(); it++) {
-        
-        // Select currently inspected particle if weight higher than previously highest weight
-        if ((*it).getWeight() > best_particle_weight) {
-            best_particle_weight = (*it).getWeight();
-            best_particle_ptr = &(*it);
-        }
+    // Compose map of particle with highest weight from the ancestry map
+    if (this->map_representation == 1){
+        this->best_map.setData(this->ancestry_map->getData(this->particles.getBestParticle()));
+        return this->best_map;
     }
     
     // Return map of particle with highest weight
-    return best_particle_ptr->getMap();
+    return this->particles.getMap(this->particles.getBestParticle());
     
 }
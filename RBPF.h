@@ -9,24 +9,41 @@
 #ifndef RBPF_h
 #define RBPF_h
 
-#include <list>
+#include <vector>
+#include <memory>
+#include <algorithm>
 #include <Eigen/Dense>
 
-#include "Particle.h"
+#include "ParticleSet.h"
 #include "Sensor.h"
 #include "ScanMatcher.h"
+#include "GridMatcher.h"
+#include "CorrelativeMatcher.h"
+#include "RayCaster.h"
+#include "ThreadPool.h"
+#include "RandomStream.h"
 #include "Map.h"
+#include "AncestryMap.h"
+#include "PolarTable.h"
+#include "Resampler.h"
 
 class Robot;
 
 using namespace std;
 
+// Occupancy update of a single grid cell
+typedef struct {
+    int x_px;
+    int y_px;
+    int occupancy_update;
+} CellUpdate;
+
 class RBPF {
     
     public:
         // Constructor and destructor
         RBPF();
-        RBPF(int n_particles, Eigen::Vector3f R, int max_iterations, float tolerance, float discard_fraction);
+        RBPF(int n_particles, Eigen::Vector3f R, int max_iterations, float tolerance, float discard_fraction, int n_threads, int map_representation, int mapping_mode, int scan_matching_mode, float search_window_linear, float search_window_angular, int measurement_model);
         ~RBPF(){};
         
         // Summary of RBPF
@@ -42,25 +59,88 @@ class RBPF {
         void scan_matching(const Eigen::Vector3f &pose, Sensor& sensor);
         void weight(Sensor& sensor);
         void resample();
-        double motion_model_velocity(Eigen::Vector3f particle_pose, Eigen::Vector3f sample_pose, Eigen::Vector2f odometry_signal, float current_timestamp);
+        double motion_model_velocity(Eigen::Vector3f particle_pose, Eigen::Vector3f sample_pose, Eigen::Vector2f odometry_signal, float current_timestamp, RandomStream& random);
         
         // Getter functions
         Map& getMap();
-        list<Particle>& getParticles(){ return this->particles; };
+        ParticleSet& getParticles(){ return this->particles; };
         const int getN(){ return this->n_particles; };
+        const int& getNSamples(){ return this->n_samples; };
         const Eigen::Vector3f getR(){ return this->R; };
-        ScanMatcher& getScanMatcher(){ return this->scan_matcher; };
+        ScanMatcher& getScanMatcher(){ return this->scan_matchers[0]; };
+        GridMatcher& getGridMatcher(){ return this->grid_matchers[0]; };
+        CorrelativeMatcher& getCorrelativeMatcher(){ return this->correlative_matchers[0]; };
+        RayCaster& getRayCaster(){ return this->ray_caster; };
+        Resampler& getResampler(){ return this->resampler; };
+        ThreadPool& getThreadPool(){ return *this->thread_pool; };
         float& getLastTimestamp(){ return this->last_timestamp; };
+        const int& getStep(){ return this->step; };
+        const int& getMapRepresentation(){ return this->map_representation; };
+        const int& getMappingMode(){ return this->mapping_mode; };
+        const int& getScanMatchingMode(){ return this->scan_matching_mode; };
+        const long& getNScanMatchingIterations(){ return this->n_scan_matching_iterations; };
+        const int& getMeasurementModel(){ return this->measurement_model; };
+        AncestryMap& getAncestryMap(){ return *this->ancestry_map; };
+        
+        const int& getKLDSampling(){ return this->kld_sampling; };
         
         // Setter functions
-        void setScanMatcher(ScanMatcher& scan_matcher){ this->scan_matcher = scan_matcher; };
+        void setScanMatcher(ScanMatcher& scan_matcher){ fill(this->scan_matchers.begin(), this->scan_matchers.end(), scan_matcher); };
+        void setResampler(Resampler& resampler){ this->resampler = resampler; };
+        void setKLDSampling(int n_particles_min, int n_particles_max, float epsilon, float z, float bin_size_xy, float bin_size_theta);
+        void setVerbose(int verbose){ this->verbose = verbose; };
         
     private:
+        // Per-particle work of the individual filter stages
+        void cast_particle(const int& particle_id, const Eigen::Vector3f& pose, Sensor& sensor, Eigen::MatrixX2f& measurement_estimate);
+        void cast_particle(const int& particle_id, const vector<Eigen::Vector3f>& poses, Sensor& sensor, vector<Eigen::MatrixX2f>& measurement_estimates);
+        void scan_matching_particle(const int& particle_id, const int& worker_id, const Eigen::Vector3f& pose, Sensor& sensor);
+        template<typename Grid>
+        Eigen::Vector3f match_grid(const Grid& map, const int& worker_id, const Eigen::Vector3f& pose, Sensor& sensor);
+        void count_scan_matching_iterations();
+        double improved_proposal_particle(const int& particle_id, Sensor& sensor, Eigen::Vector2f odometry_signal, float current_timestamp);
+        double weight_particle(const int& particle_id, Sensor& sensor);
+        static double beam_log_likelihood(const Eigen::MatrixX2f& measurements, const Eigen::MatrixX2f& measurement_estimate, const float& sigma, const float& max_range);
+        void likelihood_field_particle(const int& particle_id, const vector<Eigen::Vector3f>& poses, Sensor& sensor, vector<double>& log_likelihoods);
+        void update_likelihood_field_particle(const int& particle_id, Sensor& sensor);
+        void initialize_likelihood_fields();
+        void mapping_particle(const int& particle_id, Sensor& sensor);
+        const vector<CellUpdate>& trace_beams(const Eigen::Vector3f& map_pose, Sensor& sensor);
+    
+        // Number of particles required by KLD-sampling to approximate the posterior given by the cumulative weights
+        int kld_particle_count(const vector<float>& cum_sum, RandomStream& random);
+    
+        // Normalize particle weights to a sum of 1 given their logarithms
+        void normalize_weights(const Eigen::ArrayXd& log_weights);
+    
         float last_timestamp;
-        list<Particle> particles;
+        int step; // number of filter updates, used to key the random streams
+        int verbose; // 1 -> print number of effective particles, 2 -> additionally print weights of all particles
+        ParticleSet particles; // poses, weights and maps of all particles
         int n_particles;
+        Resampler resampler; // draws the ancestors of the particles in the resampling step
+        int kld_sampling; // 0 -> fixed number of particles, 1 -> number of particles adapted by KLD-sampling
+        int n_particles_min; // bounds of the number of particles for KLD-sampling
+        int n_particles_max;
+        float kld_epsilon; // maximum KL divergence between sample-based and true posterior
+        float kld_z; // upper 1 - delta quantile of the standard normal distribution
+        float kld_bin_size_xy; // size of the histogram bins of KLD-sampling on x and y in m
+        float kld_bin_size_theta; // size of the histogram bins of KLD-sampling on the heading in rad
+        int n_samples; // number of samples drawn around the scan-matching pose
         Eigen::Vector3f R;
-        ScanMatcher scan_matcher;
+        vector<ScanMatcher> scan_matchers; // one scan matcher per worker thread, each owns its workspaces
+        vector<GridMatcher> grid_matchers; // one grid matcher per worker thread
+        vector<CorrelativeMatcher> correlative_matchers; // one correlative matcher per worker thread
+        int scan_matching_mode; // 0 -> ICP on estimated scans, 1 -> Gauss-Newton scan-to-map matching, 2 -> correlative
+        long n_scan_matching_iterations; // total number of scan matching iterations of all particles
+        RayCaster ray_caster;
+        shared_ptr<ThreadPool> thread_pool; // worker pool shared between copies of the filter
+        int map_representation; // 0 -> one grid map per particle, 1 -> ancestry map shared by all particles
+        shared_ptr<AncestryMap> ancestry_map; // map shared by all particles
+        Map best_map; // map of the best particle composed from the ancestry map
+        int mapping_mode; // 0 -> inverse sensor model on all cells within range, 1 -> trace measured beams
+        PolarTable polar_table; // polar coordinates of all cells within range for the inverse sensor model
+        int measurement_model; // 0 -> beam model on ray-cast measurement estimates, 1 -> likelihood field
     
 };
 
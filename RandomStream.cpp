@@ -0,0 +1,134 @@
+//
+//  RandomStream.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 20.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <math.h>
+
+#include "RandomStream.h"
+
+using namespace std;
+
+#define PI 3.14159265
+
+
+// Initialize static member variables
+// Default value will be overwritten by specified simulation seed
+uint64_t RandomStream::seed = 0;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+RandomStream::RandomStream(uint32_t step, uint32_t stream_id, uint32_t sample_id){
+
+    // Derive key from global seed
+    this->key[0] = (uint32_t) (RandomStream::seed & 0xFFFFFFFF);
+    this->key[1] = (uint32_t) (RandomStream::seed >> 32);
+
+    // Counter identifies the stream, first word counts the generated blocks
+    this->counter[0] = 0;
+    this->counter[1] = step;
+    this->counter[2] = stream_id;
+    this->counter[3] = sample_id;
+
+    // No numbers generated yet
+    this->block_position = 4;
+    this->spare_available = false;
+    this->spare = 0.0;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Sampling +++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Draw from uniform distribution in range [0, 1)
+float RandomStream::uniform(){
+
+    // Use upper 24 bits to fill the float mantissa
+    return (float) (this->next() >> 8) * (1.0f / 16777216.0f);
+}
+
+
+// Draw from standard normal distribution using the Box-Muller transform
+float RandomStream::normal(){
+
+    // Return second sample of previous transform
+    if (this->spare_available){
+        this->spare_available = false;
+        return this->spare;
+    }
+
+    // Get two uniform samples, first in range (0, 1] to avoid log(0)
+    float u1 = 1.0f - this->uniform();
+    float u2 = this->uniform();
+
+    float radius = sqrt(-2.0f * log(u1));
+    float angle = 2.0f * PI * u2;
+
+    this->spare = radius * sin(angle);
+    this->spare_available = true;
+
+    return radius * cos(angle);
+}
+
+
+// Get next random number of the stream
+uint32_t RandomStream::next(){
+
+    // Generate new block if all numbers of the current one are used
+    if (this->block_position == 4){
+        RandomStream::philox(this->counter, this->key, this->block);
+        this->counter[0]++;
+        this->block_position = 0;
+    }
+
+    return this->block[this->block_position++];
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Philox +++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Philox4x32 with 10 rounds (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3")
+void RandomStream::philox(uint32_t counter[4], uint32_t key[2], uint32_t output[4]){
+
+    // Round multipliers and Weyl sequence constants
+    const uint32_t M0 = 0xD2511F53;
+    const uint32_t M1 = 0xCD9E8D57;
+    const uint32_t W0 = 0x9E3779B9;
+    const uint32_t W1 = 0xBB67AE85;
+
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for (int round = 0; round < 10; round++){
+
+        // Multiply and split into high and low word
+        const uint64_t product_0 = (uint64_t) M0 * c0;
+        const uint64_t product_1 = (uint64_t) M1 * c2;
+        const uint32_t hi0 = (uint32_t) (product_0 >> 32), lo0 = (uint32_t) product_0;
+        const uint32_t hi1 = (uint32_t) (product_1 >> 32), lo1 = (uint32_t) product_1;
+
+        // Permute and mix in key
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+
+        // Bump key
+        k0 += W0;
+        k1 += W1;
+    }
+
+    output[0] = c0;
+    output[1] = c1;
+    output[2] = c2;
+    output[3] = c3;
+}
@@ -0,0 +1,60 @@
+//
+//  RandomStream.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 20.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef RandomStream_h
+#define RandomStream_h
+
+#include <stdint.h>
+
+using namespace std;
+
+// Reserved stream IDs for random draws that don't belong to a particle
+const uint32_t RESAMPLING_STREAM = 0xFFFFFFFF;
+const uint32_t WHEEL_ENCODER_STREAM = 0xFFFFFFFE;
+
+
+// Counter-based random number generator (Philox4x32-10). Every stream is keyed by the global seed and
+// identified by (step, stream ID, sample ID), so the sequence of draws of a stream doesn't depend on the
+// order in which streams are used or on the thread they are used from.
+class RandomStream {
+
+    public:
+        // Constructor and destructor
+        RandomStream(uint32_t step, uint32_t stream_id, uint32_t sample_id);
+        ~RandomStream(){};
+
+        // Draw from uniform distribution in range [0, 1)
+        float uniform();
+
+        // Draw from standard normal distribution
+        float normal();
+
+        // Static getter and setter for the global seed
+        static const uint64_t& getSeed(){ return RandomStream::seed; };
+        static void setSeed(uint64_t seed){ RandomStream::seed = seed; };
+
+    private:
+        // Generate next block of four random numbers and advance the counter
+        uint32_t next();
+
+        // Philox4x32-10 block function
+        static void philox(uint32_t counter[4], uint32_t key[2], uint32_t output[4]);
+
+        // Global seed shared by all streams
+        static uint64_t seed;
+
+        uint32_t key[2]; // key derived from the seed
+        uint32_t counter[4]; // (block index, step, stream ID, sample ID)
+        uint32_t block[4]; // current block of random numbers
+        int block_position; // position of the next unused number in the current block
+        bool spare_available; // Box-Muller produces normal samples in pairs
+        float spare;
+
+};
+
+#endif /* RandomStream_h */
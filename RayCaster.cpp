@@ -0,0 +1,81 @@
+//
+//  RayCaster.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 20.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <stdio.h>
+#include <math.h>
+#include <Eigen/Dense>
+#include <opencv2/opencv.hpp>
+
+#include "RayCaster.h"
+
+using namespace std;
+
+#define PI 3.14159265
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Ray Casting ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Estimate sensor sweep by walking each laser beam through the map until the first occupied cell is hit.
+// Cost scales with number of beams times sensor range instead of the squared sensor range.
+void RayCaster::cast(Map& map, const Eigen::Vector3f& pose, Sensor& sensor, Eigen::MatrixX2f& measurement_estimate){
+    
+    // Angle of each laser beam relative to the robot's heading
+    const Eigen::ArrayXf& beam_angles = sensor.getBeamAngles();
+    
+    RayCaster::cast_pose(map, pose, beam_angles, sensor.getRange(), measurement_estimate);
+}
+
+
+// Estimate sensor sweeps for a batch of poses (e.g. the samples of the improved proposal). Beam angles are
+// shared across all poses of the batch.
+void RayCaster::cast(Map& map, const vector<Eigen::Vector3f>& poses, Sensor& sensor, vector<Eigen::MatrixX2f>& measurement_estimates){
+    
+    // Angle of each laser beam relative to the robot's heading
+    const Eigen::ArrayXf& beam_angles = sensor.getBeamAngles();
+    
+    // Make sure there is one container per pose
+    measurement_estimates.resize(poses.size());
+    
+    // Iterate over all poses of the batch
+    for (int pose_id = 0; pose_id < (int) poses.size(); pose_id++) {
+        RayCaster::cast_pose(map, poses[pose_id], beam_angles, sensor.getRange(), measurement_estimates[pose_id]);
+    }
+}
+
+
+// Estimate sensor sweep of a given pose on the ancestry map as seen by the specified particle
+void RayCaster::cast(AncestryMap& map, const int& particle_id, const Eigen::Vector3f& pose, Sensor& sensor, Eigen::MatrixX2f& measurement_estimate){
+    
+    // Angle of each laser beam relative to the robot's heading
+    const Eigen::ArrayXf& beam_angles = sensor.getBeamAngles();
+    
+    // Resolve the particle's ancestors once for all beams
+    const AncestryMap::View view(map, particle_id);
+    RayCaster::cast_pose(view, pose, beam_angles, sensor.getRange(), measurement_estimate);
+}
+
+
+// Estimate sensor sweeps for a batch of poses on the ancestry map as seen by the specified particle
+void RayCaster::cast(AncestryMap& map, const int& particle_id, const vector<Eigen::Vector3f>& poses, Sensor& sensor, vector<Eigen::MatrixX2f>& measurement_estimates){
+    
+    // Angle of each laser beam relative to the robot's heading
+    const Eigen::ArrayXf& beam_angles = sensor.getBeamAngles();
+    
+    // Resolve the particle's ancestors once for the whole batch
+    const AncestryMap::View view(map, particle_id);
+    
+    // Make sure there is one container per pose
+    measurement_estimates.resize(poses.size());
+    
+    // Iterate over all poses of the batch
+    for (int pose_id = 0; pose_id < (int) poses.size(); pose_id++) {
+        RayCaster::cast_pose(view, poses[pose_id], beam_angles, sensor.getRange(), measurement_estimates[pose_id]);
+    }
+}
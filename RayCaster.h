@@ -0,0 +1,179 @@
+//
+//  RayCaster.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 20.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef RayCaster_h
+#define RayCaster_h
+
+#include <math.h>
+#include <limits>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "Map.h"
+#include "AncestryMap.h"
+#include "Sensor.h"
+#include "Profiler.h"
+
+using namespace std;
+
+
+class RayCaster {
+
+    public:
+        // Constructor and destructor
+        RayCaster(){};
+        ~RayCaster(){};
+
+        // Estimate sensor sweep of a given pose by casting each laser beam through the map
+        void cast(Map& map, const Eigen::Vector3f& pose, Sensor& sensor, Eigen::MatrixX2f& measurement_estimate);
+    
+        // Estimate sensor sweeps of a batch of poses on the same map
+        void cast(Map& map, const vector<Eigen::Vector3f>& poses, Sensor& sensor, vector<Eigen::MatrixX2f>& measurement_estimates);
+    
+        // Estimate sensor sweeps on the shared ancestry map as seen by a particle
+        void cast(AncestryMap& map, const int& particle_id, const Eigen::Vector3f& pose, Sensor& sensor, Eigen::MatrixX2f& measurement_estimate);
+        void cast(AncestryMap& map, const int& particle_id, const vector<Eigen::Vector3f>& poses, Sensor& sensor, vector<Eigen::MatrixX2f>& measurement_estimates);
+
+        // Walk a ray through the grid cell by cell (DDA traversal)
+        template<typename Visitor>
+        static void traverse(const int& x_start, const int& y_start, const float& angle, const float& max_distance,
+                             const int& width, const int& height, Visitor visit);
+    
+    private:
+        // Cast all beams of a single pose given the shared map data and beam angles of a batch. Grid is any
+        // type providing getValue(x_px, y_px), getRows() and getCols().
+        template<typename Grid>
+        static void cast_pose(const Grid& map, const Eigen::Vector3f& pose, const Eigen::ArrayXf& beam_angles,
+                              const float& range, Eigen::MatrixX2f& measurement_estimate);
+
+};
+
+
+// Visit all cells intersected by a ray starting at the mass center of cell (x_start, y_start) in the
+// direction of angle until max_distance (in map coordinates) is exceeded or the ray leaves the map.
+// The visitor is called with the cell coordinates and the distance between the mass centers of the start
+// cell and the visited cell and returns false to stop the traversal.
+template<typename Visitor>
+void RayCaster::traverse(const int& x_start, const int& y_start, const float& angle, const float& max_distance,
+                         const int& width, const int& height, Visitor visit){
+
+    // Direction of the ray
+    const float dir_x = cos(angle);
+    const float dir_y = sin(angle);
+
+    // Step direction along both axes
+    const int step_x = (dir_x >= 0) ? 1 : -1;
+    const int step_y = (dir_y >= 0) ? 1 : -1;
+
+    // Distance along the ray between two vertical and two horizontal cell borders
+    const float infinity = numeric_limits<float>::infinity();
+    const float t_delta_x = (abs(dir_x) > 1e-9) ? 1.0 / abs(dir_x) : infinity;
+    const float t_delta_y = (abs(dir_y) > 1e-9) ? 1.0 / abs(dir_y) : infinity;
+
+    // Distance along the ray to the first vertical and horizontal cell border (ray starts at mass center)
+    float t_max_x = 0.5 * t_delta_x;
+    float t_max_y = 0.5 * t_delta_y;
+
+    // Currently inspected cell
+    int x_px = x_start;
+    int y_px = y_start;
+
+    // Distance travelled along the ray when entering the current cell
+    float t = 0.0;
+
+    while (t <= max_distance) {
+
+        // Stop if ray leaves the map
+        if (x_px < 0 || x_px >= width || y_px < 0 || y_px >= height) {
+            return; }
+
+        // Distance between mass centers of start cell and current cell
+        const int dx = x_px - x_start;
+        const int dy = y_px - y_start;
+        const float cell_distance = sqrt((float)(dx * dx + dy * dy));
+
+        if (!visit(x_px, y_px, cell_distance)) {
+            return; }
+
+        // Advance to the next cell along the axis whose border is closer
+        if (t_max_x < t_max_y) {
+            t = t_max_x;
+            t_max_x += t_delta_x;
+            x_px += step_x;
+        }
+        else {
+            t = t_max_y;
+            t_max_y += t_delta_y;
+            y_px += step_y;
+        }
+    }
+}
+
+// Cast all beams of a single pose
+template<typename Grid>
+void RayCaster::cast_pose(const Grid& map, const Eigen::Vector3f& pose, const Eigen::ArrayXf& beam_angles,
+                          const float& range, Eigen::MatrixX2f& measurement_estimate){
+
+    // Transform pose from world coordinates to map coordinates
+    Eigen::Array3f map_pose = Map::world2map(pose);
+    const int x_r = (int) map_pose(0);
+    const int y_r = (int) map_pose(1);
+    const float heading_r = (float) map_pose(2);
+
+    // Transform sensor's maximum range to map scale
+    const int map_range = Map::world2map(range);
+    
+    // Number of laser beams
+    const int n_beams = (int) beam_angles.size();
+
+    // Instantiate container for estimated measurements
+    measurement_estimate.resize(n_beams, 2);
+    measurement_estimate.col(0) = beam_angles; // Set angle for each laser beam
+    measurement_estimate.col(1).setConstant(range); // Initialize measurements to sensor range
+
+    // Map dimensions shared by all beams
+    const int width = map.getCols();
+    const int height = map.getRows();
+    const int threshold = Map::getThreshold();
+
+    // Number of visited cells and of beams ending at an occupied cell
+    long n_visited = 0;
+    long n_hits = 0;
+
+    // Iterate over all laser beams
+    for (int beam_id = 0; beam_id < n_beams; beam_id++) {
+
+        // Absolute angle of the laser beam in map coordinates
+        const float beam_angle = heading_r + beam_angles(beam_id);
+
+        // Walk along the beam and stop at the first occupied cell
+        RayCaster::traverse(x_r, y_r, beam_angle, (float) map_range, width, height,
+                            [&](const int& x_px, const int& y_px, const float& cell_distance){
+
+            n_visited++;
+
+            // Cells beyond the sensor range are not detected
+            if (cell_distance >= map_range) {
+                return false; }
+
+            // Update estimated distance if occupied cell detected (the sensor's own cell is skipped)
+            if (cell_distance > 0 && map.getValue(x_px, y_px) < threshold) {
+                measurement_estimate(beam_id, 1) = Map::map2world((int)cell_distance);
+                n_hits++;
+                return false;
+            }
+
+            return true;
+        });
+    }
+
+    PROFILE_COUNT(CounterRayCastCells, n_visited);
+    PROFILE_COUNT(CounterOccupiedCellsHit, n_hits);
+}
+
+#endif /* RayCaster_h */
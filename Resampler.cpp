@@ -0,0 +1,170 @@
+//
+//  Resampler.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 05.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+#include <math.h>
+#include <algorithm>
+
+#include "Resampler.h"
+
+using namespace std;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Standard constructor
+Resampler::Resampler() : Resampler(Systematic) {}
+
+
+// Constructor
+Resampler::Resampler(int method){
+    
+    if (method < Systematic || method > Residual){
+        cout << "Invalid resampling method: " << method << " (0 = Systematic, 1 = Stratified, 2 = Residual)" << endl;
+        exit(1);
+    }
+    this->method = method;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void Resampler::summary(){
+    
+    const string method_names[] = {"Systematic", "Stratified", "Residual"};
+    
+    cout << "Resampler:" << endl;
+    cout << "----------" << endl;
+    cout << "Method: " << method_names[this->method] << endl;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++ Resampling ++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Draw ancestors of the next generation
+const vector<int>& Resampler::resample(const Eigen::ArrayXd& weights, const int& n_resampled, RandomStream& random){
+    
+    // Count offspring of each particle
+    this->counts.assign(weights.size(), 0);
+    switch (this->method) {
+        case Stratified: this->stratified(weights, n_resampled, random);
+            break;
+        case Residual: this->residual(weights, n_resampled, random);
+            break;
+        default: this->systematic(weights, n_resampled, random);
+            break;
+    }
+    
+    // Assign ancestors to the slots of the next generation
+    this->assign_slots(n_resampled);
+    
+    return this->ancestor_ids;
+}
+
+
+// Systematic resampling: a single random offset, thresholds spaced 1/N apart. Thresholds and cumulative
+// weights are both increasing, so they are merged in a single pass.
+void Resampler::systematic(const Eigen::ArrayXd& weights, const int& n_resampled, RandomStream& random){
+    
+    const int n_particles = (int) weights.size();
+    const double step = weights.sum() / n_resampled;
+    double threshold = random.uniform() * step;
+    double cum_sum = 0.0;
+    int particle_id = -1;
+    
+    for (int sample_id = 0; sample_id < n_resampled; sample_id++, threshold += step) {
+        
+        // Advance to the first particle whose cumulative weight exceeds the threshold
+        while (particle_id < n_particles - 1 && cum_sum <= threshold) {
+            particle_id++;
+            cum_sum += weights(particle_id);
+        }
+        this->counts[max(particle_id, 0)]++;
+    }
+}
+
+
+// Stratified resampling: one random offset for each of the N strata of width 1/N
+void Resampler::stratified(const Eigen::ArrayXd& weights, const int& n_resampled, RandomStream& random){
+    
+    const int n_particles = (int) weights.size();
+    const double step = weights.sum() / n_resampled;
+    double cum_sum = 0.0;
+    int particle_id = -1;
+    
+    for (int sample_id = 0; sample_id < n_resampled; sample_id++) {
+        
+        const double threshold = (sample_id + random.uniform()) * step;
+        while (particle_id < n_particles - 1 && cum_sum <= threshold) {
+            particle_id++;
+            cum_sum += weights(particle_id);
+        }
+        this->counts[max(particle_id, 0)]++;
+    }
+}
+
+
+// Residual resampling: every particle gets the integer part of its expected number of offspring, the remaining
+// slots are filled by systematic resampling of the fractional parts
+void Resampler::residual(const Eigen::ArrayXd& weights, const int& n_resampled, RandomStream& random){
+    
+    const int n_particles = (int) weights.size();
+    const Eigen::ArrayXd expected = weights / weights.sum() * n_resampled;
+    
+    // Deterministic offspring
+    int n_assigned = 0;
+    for (int particle_id = 0; particle_id < n_particles; particle_id++) {
+        this->counts[particle_id] = (int) floor(expected(particle_id));
+        n_assigned += this->counts[particle_id];
+    }
+    
+    // Draw the remaining offspring from the fractional parts
+    const int n_remaining = n_resampled - n_assigned;
+    if (n_remaining > 0) {
+        this->residual_weights = expected - expected.floor();
+        const vector<int> deterministic_counts = this->counts;
+        this->counts.assign(n_particles, 0);
+        this->systematic(this->residual_weights, n_remaining, random);
+        for (int particle_id = 0; particle_id < n_particles; particle_id++) {
+            this->counts[particle_id] += deterministic_counts[particle_id];
+        }
+    }
+}
+
+
+// Every particle with offspring that has a slot in the next generation keeps it, its further offspring and the
+// offspring of particles without a slot are distributed over the slots of particles without offspring
+void Resampler::assign_slots(const int& n_resampled){
+    
+    const int n_particles = (int) this->counts.size();
+    this->ancestor_ids.assign(n_resampled, -1);
+    
+    // Surviving particles keep their slot
+    for (int particle_id = 0; particle_id < min(n_particles, n_resampled); particle_id++) {
+        if (this->counts[particle_id] > 0) {
+            this->ancestor_ids[particle_id] = particle_id;
+            this->counts[particle_id]--;
+        }
+    }
+    
+    // Fill the remaining slots with the remaining offspring in order of their ancestors
+    int slot_id = 0;
+    for (int particle_id = 0; particle_id < n_particles; particle_id++) {
+        for (; this->counts[particle_id] > 0; this->counts[particle_id]--) {
+            while (this->ancestor_ids[slot_id] >= 0) {
+                slot_id++; }
+            this->ancestor_ids[slot_id] = particle_id;
+        }
+    }
+}
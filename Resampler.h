@@ -0,0 +1,65 @@
+//
+//  Resampler.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 05.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef Resampler_h
+#define Resampler_h
+
+#include <vector>
+#include <Eigen/Dense>
+
+#include "RandomStream.h"
+
+using namespace std;
+
+// Resampling methods
+enum resampler_type {
+    Systematic,
+    Stratified,
+    Residual,
+};
+
+
+// Draws the ancestors of the particles of the next generation from their weights. The number of offspring of
+// each particle is computed in a single pass over the cumulative weights. Ancestors are then assigned to particle
+// slots such that every surviving particle keeps its own slot, so the filter only has to overwrite the slots of
+// particles that died with copies of duplicated ones and can permute its particles in place.
+class Resampler {
+
+    public:
+        // Constructor and destructor
+        Resampler();
+        Resampler(int method);
+        ~Resampler(){};
+
+        // Print resampler summary
+        void summary();
+
+        // Draw n_resampled ancestors from the weights. Returns the ancestor of each slot of the next generation,
+        // ancestor_ids[i] == i for every surviving particle i < n_resampled.
+        const vector<int>& resample(const Eigen::ArrayXd& weights, const int& n_resampled, RandomStream& random);
+
+        // Getter functions
+        const int& getMethod(){ return this->method; };
+
+    private:
+        // Number of offspring of each particle for the individual methods
+        void systematic(const Eigen::ArrayXd& weights, const int& n_resampled, RandomStream& random);
+        void stratified(const Eigen::ArrayXd& weights, const int& n_resampled, RandomStream& random);
+        void residual(const Eigen::ArrayXd& weights, const int& n_resampled, RandomStream& random);
+
+        // Assign ancestors to slots given the number of offspring of each particle
+        void assign_slots(const int& n_resampled);
+
+        int method; // 0 -> systematic, 1 -> stratified, 2 -> residual
+        vector<int> counts; // number of offspring of each particle
+        vector<int> ancestor_ids; // ancestor of each slot of the next generation
+        Eigen::ArrayXd residual_weights; // fractional parts of the expected number of offspring (residual)
+
+};
+
+#endif /* Resampler_h */
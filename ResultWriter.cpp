@@ -0,0 +1,149 @@
+//
+//  ResultWriter.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 10.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+
+#include "ResultWriter.h"
+#include "Tracer.h"
+
+using namespace std;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++ Constructor/Destructor ++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Constructor. Starts the worker threads, at least one.
+ResultWriter::ResultWriter(int n_threads, int capacity, int policy){
+
+    this->n_threads = max(1, n_threads);
+    this->capacity = max(1, capacity);
+    this->policy = policy;
+
+    // Initialize queue state
+    this->stop = false;
+    this->n_busy = 0;
+    this->n_written = 0;
+    this->n_dropped = 0;
+
+    // Start worker threads
+    for (int worker_id = 0; worker_id < this->n_threads; worker_id++){
+        this->workers.push_back(thread(&ResultWriter::worker_loop, this));
+    }
+}
+
+
+// Destructor. Workers write all queued images before they are joined.
+ResultWriter::~ResultWriter(){
+
+    {
+        lock_guard<mutex> lock(this->queue_mutex);
+        this->stop = true;
+    }
+    this->image_available.notify_all();
+
+    for (vector<thread>::iterator it = this->workers.begin(); it != this->workers.end(); it++){
+        (*it).join();
+    }
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void ResultWriter::summary(){
+
+    cout << "Result Writer:" << endl;
+    cout << "--------------" << endl;
+    cout << "Number of Threads: " << this->n_threads << endl;
+    cout << "Queue Capacity: " << this->capacity << endl;
+    cout << "Policy: " << result_writer_policies[this->policy] << endl;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Write Images +++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Queue copy of an image
+void ResultWriter::write(const cv::Mat& image, const string& file_path){
+
+    // Copy image before taking the lock
+    ResultImage result_image;
+    result_image.image = image.clone();
+    result_image.file_path = file_path;
+
+    {
+        unique_lock<mutex> lock(this->queue_mutex);
+
+        // Apply back-pressure policy if the queue is full
+        if (this->policy == DropOldest){
+            if ((int) this->queue.size() >= this->capacity){
+                this->queue.pop_front();
+                this->n_dropped++;
+            }
+        }
+        else {
+            this->space_available.wait(lock, [this]{ return (int) this->queue.size() < this->capacity; });
+        }
+
+        this->queue.push_back(move(result_image));
+    }
+    this->image_available.notify_one();
+}
+
+
+// Wait until the queue is empty and no worker is writing
+void ResultWriter::flush(){
+
+    unique_lock<mutex> lock(this->queue_mutex);
+    this->all_written.wait(lock, [this]{ return this->queue.empty() && this->n_busy == 0; });
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++ Worker Loop +++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Main loop of the worker threads
+void ResultWriter::worker_loop(){
+
+    while (true){
+
+        // Wait for queued image or stop signal, queued images are written before stopping
+        ResultImage result_image;
+        {
+            unique_lock<mutex> lock(this->queue_mutex);
+            this->image_available.wait(lock, [this]{ return this->stop || !this->queue.empty(); });
+            if (this->queue.empty()){
+                return;
+            }
+            result_image = move(this->queue.front());
+            this->queue.pop_front();
+            this->n_busy++;
+        }
+        this->space_available.notify_one();
+
+        // Encode and write image
+        {
+            TRACE_SCOPE("write_image");
+            if (!cv::imwrite(result_image.file_path, result_image.image)){
+                cout << "Unable to write " << result_image.file_path << "!" << endl;
+            }
+        }
+
+        // Report completion
+        {
+            lock_guard<mutex> lock(this->queue_mutex);
+            this->n_busy--;
+            this->n_written++;
+        }
+        this->all_written.notify_all();
+    }
+}
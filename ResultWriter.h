@@ -0,0 +1,91 @@
+//
+//  ResultWriter.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 10.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef ResultWriter_h
+#define ResultWriter_h
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+
+using namespace std;
+
+// Behavior of the writer if its queue is full
+enum result_writer_policy{
+    Block, // wait until a queued image was written
+    DropOldest, // discard the oldest queued image
+};
+
+// String names of the writer policies
+const string result_writer_policies [] {
+    "Block",
+    "Drop Oldest",
+};
+
+// Image waiting to be written
+typedef struct {
+    cv::Mat image;
+    string file_path;
+} ResultImage;
+
+
+// Writes images in the background. Images are copied when they are queued, so the caller can keep drawing on
+// its own data, and encoded by worker threads. The queue holds a bounded number of images, the policy decides
+// whether a full queue blocks the caller or drops the oldest image.
+class ResultWriter {
+
+    public:
+        // Constructor and destructor, the destructor writes all queued images
+        ResultWriter(int n_threads = 1, int capacity = 8, int policy = Block);
+        ~ResultWriter();
+
+        // Disable copying, the writer owns its worker threads
+        ResultWriter(const ResultWriter&) = delete;
+        ResultWriter& operator=(const ResultWriter&) = delete;
+
+        // Print result writer summary
+        void summary();
+
+        // Queue copy of an image to be written to a file
+        void write(const cv::Mat& image, const string& file_path);
+
+        // Wait until all queued images are written
+        void flush();
+
+        // Getter functions
+        const long& getNWritten(){ return this->n_written; };
+        const long& getNDropped(){ return this->n_dropped; };
+
+    private:
+        // Main loop of the worker threads
+        void worker_loop();
+
+        int n_threads; // number of worker threads
+        int capacity; // maximum number of queued images
+        int policy; // behavior if the queue is full
+        vector<thread> workers; // worker threads
+
+        // Synchronization of workers
+        mutex queue_mutex;
+        condition_variable image_available;
+        condition_variable space_available;
+        condition_variable all_written;
+        bool stop;
+
+        deque<ResultImage> queue; // images waiting to be written
+        int n_busy; // number of images currently written by the workers
+        long n_written; // number of written images
+        long n_dropped; // number of images dropped from a full queue
+
+};
+
+#endif /* ResultWriter_h */
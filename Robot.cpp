@@ -13,6 +13,7 @@
 #include <math.h>
 
 #include "Robot.h"
+#include "Tracer.h"
 
 using namespace std;
 using namespace cv;
@@ -68,6 +69,8 @@ void Robot::summary(){
 
 Eigen::Vector2f Robot::drive(const float &delta_t){
         
+    TRACE_SCOPE("drive");
+        
     // Pose difference due to constant control signal applied over period of delta_t
     Eigen::Vector3f pose_dif;
     pose_dif(0) = delta_t * this->v * cos((float)this->pose(2));
@@ -42,6 +42,8 @@ class Robot {
         const float& getTimestamp(){ return this->last_timestamp; };
 
         // Setter functions
+        void setPose(const Eigen::Vector3f& pose){ this->pose = pose; };
+        void setTimestamp(const float& timestamp){ this->last_timestamp = timestamp; };
         void setV(const float& v){ this->v = v; };
         void setOmega(const float& omega){ this->omega = omega; };
         void setSensor(Sensor& sensor){ this->sensor = sensor; };
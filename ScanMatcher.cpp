@@ -13,6 +13,7 @@
 #include <math.h>
 #include <opencv2/opencv.hpp>
 #include <numeric>
+#include <algorithm>
 
 #include "ScanMatcher.h"
 
@@ -30,6 +31,7 @@ ScanMatcher::ScanMatcher(){
     this->max_iterations = 20;
     this->tolerance = 0.01;
     this->discard_fraction = 0.1;
+    this->n_iterations = 0;
     
 }
 
@@ -38,6 +40,7 @@ ScanMatcher::ScanMatcher(){
 ScanMatcher::ScanMatcher(int max_iterations, float tolerance, float discard_fraction): max_iterations(max_iterations), tolerance(tolerance) {
     
     this->discard_fraction = discard_fraction;
+    this->n_iterations = 0;
 }
 
 
@@ -115,35 +118,12 @@ void draw_scan_matching(Eigen::MatrixX2f A, Eigen::MatrixX2f B){
 
 
 // Compute pose correction
-Eigen::Vector3f ScanMatcher::ICP(Eigen::MatrixX2f &measurement_estimate, Eigen::MatrixX2f &measurement, const Eigen::Vector3f R){
+Eigen::Vector3f ScanMatcher::ICP(const Eigen::MatrixX2f &measurement_estimate, const Eigen::MatrixX2f &measurement, const Eigen::Vector3f R){
     
-    // Get measurements and measurement estimates
-    Eigen::MatrixX2f A = measurement_estimate;
-    Eigen::MatrixX2f B = measurement;
-    
-    // Get the distance offset between measurement and estimate
-    Eigen::VectorXf dif_norm  = (A - B).array().pow(2).rowwise().sum();
-    
-    // Number of worst measurements to be discarded before scan matching
-    int n_invalid = (int) (A.rows() * this->discard_fraction);
-    
-    // Iterate over measurements to delete the worst
-    for (int invalid_id = 0; invalid_id < n_invalid; invalid_id++){
-        
-        // Get index of measurement with largest offset
-        VectorXf::Index row_id;
-        dif_norm.maxCoeff(&row_id);
-        
-        // Delete corresponding row from both matrices
-        A.block(row_id,0,A.rows()-1-row_id,A.cols()) = A.bottomRows(A.rows()-1-row_id);
-        A.conservativeResize(A.rows()-1,A.cols());
-        B.block(row_id,0,B.rows()-1-row_id,B.cols()) = B.bottomRows(B.rows()-1-row_id);
-        B.conservativeResize(B.rows()-1,B.cols());
-        
-        // Delete measurement from the list of offsets
-        dif_norm.block(row_id, 0, dif_norm.rows()-1-row_id, 1) = dif_norm.bottomRows(dif_norm.rows()-1-row_id);
-        dif_norm.conservativeResize(dif_norm.rows()-1,dif_norm.cols());
-    }
+    // Discard worst measurements and get inliers of measurements and measurement estimates
+    const int n_points = this->select_inliers(measurement_estimate, measurement);
+    Eigen::Ref<const Eigen::MatrixX2f> A = this->source.topRows(n_points);
+    Eigen::Ref<const Eigen::MatrixX2f> B = this->reference.topRows(n_points);
     
     // Homogeneous transformation matrix
     Eigen::Matrix3f T = Eigen::Matrix3f::Identity(3, 3);
@@ -153,44 +133,43 @@ Eigen::Vector3f ScanMatcher::ICP(Eigen::MatrixX2f &measurement_estimate, Eigen::
     
     float prev_error = 0;
     float mean_error = 0;
-    Eigen::MatrixX2f A_trans = Eigen::MatrixX2f::Zero(A.rows(), A.cols());
-    A_trans = A.replicate(1, 1);
+    this->source_transformed.topRows(n_points) = A;
+    Eigen::Ref<Eigen::MatrixX2f> A_trans = this->source_transformed.topRows(n_points);
+    Eigen::Ref<Eigen::MatrixX2f> B_ordered = this->reference_ordered.topRows(n_points);
+
+    // Spatial index over the reference point cloud, reused in all iterations
+    this->tree.build(B);
 
     for (int iter = 0; iter<this->max_iterations; iter++){
         
+        this->n_iterations++;
+        
         //draw_scan_matching(A_trans, B);
         
         // Get neighbor information
-        nn_result nn_info = nearest_neighbor(A_trans, B);
-    
-        // Homogeneous version of A
-        Eigen::MatrixX3f A_hom = Eigen::MatrixX3f::Zero(A.rows(), A.cols()+1);
-        A_hom(A_hom.rows()-1, A_hom.cols()-1) = 1.0;
-        A_hom.block(0,0, A.rows(), A.cols()) = A_trans;
-                
-        // Container for transformed point cloud A
-        //Eigen::MatrixX2f A_trans = Eigen::MatrixX2f::Zero(A.rows(), A.cols());
+        nearest_neighbor(A_trans, this->tree, this->nn_info);
         
         // Version of B with nearest neighbor assigned to same index as in A
-        Eigen::MatrixX2f B_ordered = Eigen::MatrixX2f::Zero(B.rows(), B.cols());
-        
-        for(int ref_id = 0; ref_id < B.rows(); ref_id++){
-            B_ordered.block<1,2>(ref_id, 0) = B.block<1,2>(nn_info.indices[ref_id], 0);
+        for(int ref_id = 0; ref_id < n_points; ref_id++){
+            B_ordered.row(ref_id) = B.row(this->nn_info.indices[ref_id]);
         }
                 
         // Get best transformation matrix for current point clouds
         Eigen::Matrix3f T_t = fit_transform(A_trans, B_ordered);
                         
         // Get transformed point cloud A
-        A_hom = (T_t * A_hom.transpose()).transpose();
-        A_trans = A_hom.block(0,0, A.rows(), A.cols());
+        const Eigen::Matrix2f R_t = T_t.block<2,2>(0,0);
+        const Eigen::Vector2f t_t = T_t.block<2,1>(0,2);
+        for (int point_id = 0; point_id < n_points; point_id++){
+            const Eigen::Vector2f point = A_trans.row(point_id).transpose();
+            A_trans.row(point_id) = (R_t * point + t_t).transpose();
+        }
         
         // Compute mean error
-        mean_error = accumulate(nn_info.distances.begin(), nn_info.distances.end(), 0.0)/ nn_info.distances.size();
+        mean_error = accumulate(this->nn_info.distances.begin(), this->nn_info.distances.end(), 0.0)/ this->nn_info.distances.size();
         if (abs(prev_error - mean_error) < this->tolerance || mean_error > prev_error){
             break;
         }
-        cout << "Mean Error: " << mean_error << endl;
         
         // Update prev_error with current error
         prev_error = mean_error;
@@ -213,48 +192,77 @@ Eigen::Vector3f ScanMatcher::ICP(Eigen::MatrixX2f &measurement_estimate, Eigen::
 }
 
 
-// Fit transformation matrix
-Eigen::Matrix3f ScanMatcher::fit_transform(const Eigen::MatrixX2f &A, const Eigen::MatrixX2f &B){
+// Remove the worst matches and copy the remaining point pairs to the workspaces
+int ScanMatcher::select_inliers(const Eigen::MatrixX2f &A, const Eigen::MatrixX2f &B){
     
-    // Container for transformation matrix
-    Eigen::Matrix3f T = Eigen::Matrix3f::Identity(3,3);
+    const int n_points = (int) A.rows();
     
-    // Get centroid of each point cloud
-    Eigen::Vector2f centroid_A = A.colwise().mean();
-    Eigen::Vector2f centroid_B = B.colwise().mean();
+    // Grow workspaces if necessary
+    if (this->source.rows() < n_points){
+        this->source.resize(n_points, 2);
+        this->reference.resize(n_points, 2);
+        this->source_transformed.resize(n_points, 2);
+        this->reference_ordered.resize(n_points, 2);
+        this->offsets.resize(n_points);
+    }
+    
+    // Get the distance offset between measurement and estimate
+    this->offsets.head(n_points) = (A - B).rowwise().squaredNorm();
+    
+    // Number of worst measurements to be discarded before scan matching
+    const int n_invalid = (int) (n_points * this->discard_fraction);
+    const int n_valid = n_points - n_invalid;
+    
+    // Partition measurements by their offset, equal offsets discard the lower index first
+    this->point_ids.resize(n_points);
+    iota(this->point_ids.begin(), this->point_ids.end(), 0);
+    const float* offsets = this->offsets.data();
+    nth_element(this->point_ids.begin(), this->point_ids.begin() + n_valid, this->point_ids.end(), [offsets](const int& a, const int& b){
+        return offsets[a] < offsets[b] || (offsets[a] == offsets[b] && a > b);
+    });
+    
+    // Copy remaining measurements in their original order
+    sort(this->point_ids.begin(), this->point_ids.begin() + n_valid);
+    for (int valid_id = 0; valid_id < n_valid; valid_id++){
+        this->source.row(valid_id) = A.row(this->point_ids[valid_id]);
+        this->reference.row(valid_id) = B.row(this->point_ids[valid_id]);
+    }
+    
+    return n_valid;
+}
 
-    // Center point clouds
-    Eigen::MatrixX2f AA = (A).rowwise() - centroid_A.transpose();
-    Eigen::MatrixX2f BB = (B).rowwise() - centroid_B.transpose();
 
-    // Compute matrix product
-    Eigen::MatrixX2f H = AA.transpose() * BB;
+// Fit transformation matrix. In 2D the rotation minimizing the squared error has the closed form
+// atan2(sum(a x b), sum(a . b)) over the centered point pairs.
+Eigen::Matrix3f ScanMatcher::fit_transform(const Eigen::Ref<const Eigen::MatrixX2f> &A, const Eigen::Ref<const Eigen::MatrixX2f> &B){
     
-    // Containers for SVD matrices
-    Eigen::MatrixXf U;
-    Eigen::VectorXf S;
-    Eigen::MatrixXf V;
-    Eigen::MatrixXf Vt;
-    Eigen::MatrixXf R;
-    Eigen::Vector2f t;
+    // Container for transformation matrix
+    Eigen::Matrix3f T = Eigen::Matrix3f::Identity(3,3);
     
-    // Compute SVD
-    Eigen::JacobiSVD<Eigen::MatrixXf> svd(H, ComputeFullU | ComputeFullV);
-    U = svd.matrixU();
-    S = svd.singularValues();
-    V = svd.matrixV();
+    // Get centroid of each point cloud
+    const Eigen::Vector2f centroid_A = A.colwise().mean();
+    const Eigen::Vector2f centroid_B = B.colwise().mean();
 
-    // Get rotation matrix
-    R = V * U.transpose();
-    
-    // Special reflection
-    if (R.determinant() < 0 ){
-        V.block<2,1>(0,1) *= -1;
-        R = V * U.transpose();
+    // Accumulate cross products and dot products of centered point pairs
+    float cross = 0;
+    float dot = 0;
+    for (int point_id = 0; point_id < A.rows(); point_id++){
+        const float ax = A(point_id, 0) - centroid_A(0);
+        const float ay = A(point_id, 1) - centroid_A(1);
+        const float bx = B(point_id, 0) - centroid_B(0);
+        const float by = B(point_id, 1) - centroid_B(1);
+        cross += ax * by - ay * bx;
+        dot += ax * bx + ay * by;
     }
     
+    // Get rotation matrix
+    const float angle = atan2(cross, dot);
+    Eigen::Matrix2f R;
+    R << cos(angle), -sin(angle),
+         sin(angle), cos(angle);
+    
     // Compute translational offset
-    t = centroid_B - R * centroid_A;
+    const Eigen::Vector2f t = centroid_B - R * centroid_A;
     
     // Assign translation vector and rotation matrix
     // to homogeneous transformation matrix
@@ -267,44 +275,14 @@ Eigen::Matrix3f ScanMatcher::fit_transform(const Eigen::MatrixX2f &A, const Eige
 
 
 // Find nearest neighbor indices
-nn_result ScanMatcher::nearest_neighbor(const Eigen::MatrixX2f &A, const Eigen::MatrixX2f &B){
+void ScanMatcher::nearest_neighbor(const Eigen::Ref<const Eigen::MatrixX2f> &A, const KDTree2D &tree, nn_result &result){
     
-    // Container for NN-search result
-    nn_result result;
+    // Reuse containers of the previous iteration
+    result.distances.resize(A.rows());
+    result.indices.resize(A.rows());
     
-    // Iterate over all points in point cloud A
+    // Query nearest neighbor in point cloud B for all points in point cloud A
     for (int point_id = 0; point_id < A.rows(); point_id++) {
-        
-        // Get current point
-        Eigen::Array2f point = A.block<1,2>(point_id, 0).transpose();
-        
-        // Initialize min_distance
-        float min_distance = 10000;
-        
-        // Container for index of nearest neighbor
-        int min_index;
-        
-        // Iterate over all points in point cloud B
-        for (int ref_id = 0; ref_id < B.rows(); ref_id++){
-            
-                // Get reference point
-                Eigen::Array2f reference = B.block<1,2>(ref_id, 0).transpose();
-                
-                // Get difference vector and euclidean distance between points
-                Eigen::Vector2f dif_vector = point - reference;
-                float distance = dif_vector.squaredNorm();
-                
-                // Set new minumum index if new minumum distance
-                if (distance < min_distance){
-                    min_distance = distance;
-                    min_index = ref_id;
-                }
-        }
-        
-        // Append nearest neighbor index and distance
-        result.distances.push_back(min_distance);
-        result.indices.push_back(min_index);
+        result.indices[point_id] = tree.nearest(A(point_id, 0), A(point_id, 1), result.distances[point_id]);
     }
-    
-    return result;
 }
@@ -9,8 +9,11 @@
 #ifndef ScanMatcher_h
 #define ScanMatcher_h
 
+#include <vector>
 #include <Eigen/Dense>
 
+#include "KDTree2D.h"
+
 using namespace std;
 
 typedef struct {
@@ -19,6 +22,9 @@ typedef struct {
 } nn_result;
 
 
+// Iterative closest point matching of two 2D point clouds. All intermediate results are stored in workspaces
+// owned by the scan matcher that only grow, so repeated matching of scans of the same size does not allocate.
+// A scan matcher must not be used by multiple threads at the same time.
 class ScanMatcher {
     
     public:
@@ -28,17 +34,35 @@ class ScanMatcher {
         ~ScanMatcher(){};
         
         // Perform ICP
-        Eigen::Vector3f ICP(Eigen::MatrixX2f &A, Eigen::MatrixX2f &B, const Eigen::Vector3f R);
-        Eigen::Matrix3f fit_transform(const Eigen::MatrixX2f &A, const Eigen::MatrixX2f &B);
-        nn_result nearest_neighbor(const Eigen::MatrixX2f &A, const Eigen::MatrixX2f &B);
+        Eigen::Vector3f ICP(const Eigen::MatrixX2f &A, const Eigen::MatrixX2f &B, const Eigen::Vector3f R);
+        static Eigen::Matrix3f fit_transform(const Eigen::Ref<const Eigen::MatrixX2f> &A, const Eigen::Ref<const Eigen::MatrixX2f> &B);
+        void nearest_neighbor(const Eigen::Ref<const Eigen::MatrixX2f> &A, const KDTree2D &tree, nn_result &result);
         
         // Print scan matcher summary
         void summary();
         
+        // Number of ICP iterations since the last reset
+        const long& getNIterations(){ return this->n_iterations; };
+        void resetNIterations(){ this->n_iterations = 0; };
+        
     private:
+        // Remove the worst matches and copy the remaining point pairs to the workspaces
+        int select_inliers(const Eigen::MatrixX2f &A, const Eigen::MatrixX2f &B);
+    
         int max_iterations;
         float tolerance;
         float discard_fraction;
+        long n_iterations; // number of iterations since the last reset
+    
+        // Workspaces
+        Eigen::MatrixX2f source; // inliers of point cloud A
+        Eigen::MatrixX2f reference; // inliers of point cloud B
+        Eigen::MatrixX2f source_transformed; // point cloud A after the transformations of all iterations
+        Eigen::MatrixX2f reference_ordered; // nearest neighbors in B of the transformed points of A
+        Eigen::VectorXf offsets; // squared distances between corresponding points of A and B
+        vector<int> point_ids; // indices of the points of A sorted by their offset
+        nn_result nn_info; // nearest neighbor information of the current iteration
+        KDTree2D tree; // spatial index over the inliers of point cloud B
     
 };
 
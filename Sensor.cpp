@@ -11,6 +11,7 @@
 #include <math.h>
 
 #include "Sensor.h"
+#include "Tracer.h"
 
 #define PI 3.14159265
 
@@ -28,26 +29,58 @@ Sensor::Sensor(){
     this->FoV = 90;
     this->range = 10;
     this->resolution = 1;
+    this->start_angle = -this->FoV / 2;
     this->n_measurements = (int)((FoV/resolution) + 1);
     this->Q(0) = 0.03;
     this->Q(1) = 0.03;
     this->measurements = Eigen::MatrixX2f::Zero(this->n_measurements, 2);
+    this->set_beam_angles();
     
 }
 
-// Constructor
-Sensor::Sensor(int FoV, int range, float resolution, Eigen::Vector2f Q){
+// Constructor, beams are spread symmetrically around the robot's heading
+Sensor::Sensor(float FoV, float range, float resolution, Eigen::Vector2f Q){
     
     this->FoV = FoV;
     this->range = range;
     this->resolution = resolution;
+    this->start_angle = -FoV / 2;
     this->n_measurements = (int)((FoV/resolution) + 1);
     this->Q(0) = Q(0);
     this->Q(1) = Q(1);
     this->measurements = Eigen::MatrixX2f::Zero(this->n_measurements, 2);
+    this->set_beam_angles();
     
 }
 
+// Constructor with given angle of the first beam and number of beams (e.g. of a recorded sensor whose beams are
+// not symmetric around the heading or not aligned with full degrees)
+Sensor::Sensor(float start_angle, float resolution, int n_measurements, float range, Eigen::Vector2f Q){
+    
+    this->FoV = resolution * (n_measurements - 1);
+    this->range = range;
+    this->resolution = resolution;
+    this->start_angle = start_angle;
+    this->n_measurements = n_measurements;
+    this->Q(0) = Q(0);
+    this->Q(1) = Q(1);
+    this->measurements = Eigen::MatrixX2f::Zero(this->n_measurements, 2);
+    this->set_beam_angles();
+    
+}
+
+// Set angles of all beams from start angle and resolution
+void Sensor::set_beam_angles(){
+    
+    // Get sensor resolution in radians
+    float resol_rad = this->resolution * PI / 180;
+    
+    this->beam_angles = Eigen::ArrayXf(this->n_measurements);
+    for (int beam_id = 0; beam_id < this->n_measurements; beam_id++) {
+        this->beam_angles(beam_id) = beam_id * resol_rad + this->start_angle * PI / 180.0;
+    }
+}
+
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // ++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -60,6 +93,7 @@ void Sensor::summary(){
     cout << "FoV: " << this->FoV << "°" << endl;
     cout << "Range: " << this->range << "m" << endl;
     cout << "Resolution: " << this->resolution << "°" << endl;
+    cout << "Start Angle: " << this->start_angle << "°" << endl;
     cout << "Number of Measurements: " << this->n_measurements << endl;
     cout << "Sensor Uncertainty: " << this->Q(0) << "m, " << this->Q(1) << "rad" << endl;
 }
@@ -71,9 +105,8 @@ void Sensor::summary(){
 
 void Sensor::sweep(const vector<vector<float>> &map_coordinates, const Eigen::Vector3f &pose){
     
-    // Get sensor resolution in radians
-    float resol_rad = this->resolution * PI / 180;
-
+    TRACE_SCOPE("sensor_sweep");
+    
     // Containers for wall coordinates relative to robot's position
     vector<float> trans_x_start;
     vector<float> trans_y_start;
@@ -136,7 +169,7 @@ void Sensor::sweep(const vector<vector<float>> &map_coordinates, const Eigen::Ve
         float min_dist = (float) this->range;
         
         // Get angle of currently inspected beam relative to robot pose
-        float phi = beam_id * resol_rad - (this->FoV / 2.0) * PI / 180.0;
+        float phi = this->beam_angles(beam_id);
         
         // Get number of walls
         int n_walls = (int) map_coordinates.size();
@@ -182,3 +215,15 @@ void Sensor::sweep(const vector<vector<float>> &map_coordinates, const Eigen::Ve
     
     }
 }
+
+// Set measured ranges of all beams, beam angles are set as in a sensor sweep
+void Sensor::setRanges(const Eigen::Ref<const Eigen::VectorXf>& ranges){
+    
+    if (ranges.size() != this->n_measurements){
+        cout << "Number of ranges (" << ranges.size() << ") does not match number of beams of the sensor (" << this->n_measurements << ")!" << endl;
+        exit(1);
+    }
+    
+    this->measurements.col(0) = this->beam_angles.matrix();
+    this->measurements.col(1) = ranges;
+}
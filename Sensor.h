@@ -19,7 +19,8 @@ class Sensor {
     public:
         // Constructor and destructor
         Sensor();
-        Sensor(int FoV, int range, float resolution, Eigen::Vector2f Q);
+        Sensor(float FoV, float range, float resolution, Eigen::Vector2f Q);
+        Sensor(float start_angle, float resolution, int n_measurements, float range, Eigen::Vector2f Q);
         ~Sensor(){};
     
         // Print sensor summary
@@ -27,19 +28,30 @@ class Sensor {
 
         // Getter functions
         Eigen::MatrixX2f& getMeasurements(){ return this->measurements; };
-        const int& getRange(){ return this->range; };
+        const float& getRange(){ return this->range; };
         const int& getN(){ return this->n_measurements; };
-        const int& getFoV(){ return this->FoV; };
+        const float& getFoV(){ return this->FoV; };
+        const float& getResolution(){ return this->resolution; };
+        const float& getStartAngle(){ return this->start_angle; };
+        const Eigen::ArrayXf& getBeamAngles(){ return this->beam_angles; };
         const Eigen::Vector2f& getQ(){ return this->Q; };
 
         // Compute sensor sweep
         void sweep(const vector<vector<float>>& map_coordinates, const Eigen::Vector3f& pose);
     
+        // Set measured ranges of all beams (e.g. from a recorded sweep)
+        void setRanges(const Eigen::Ref<const Eigen::VectorXf>& ranges);
+    
     private:
-        int FoV; // sensor's field of view in degree
-        int range; // sensor's maximum range in m
-        float resolution; // sensor's resolution in beams/degree
+        // Set angles of all beams from start angle and resolution
+        void set_beam_angles();
+    
+        float FoV; // sensor's field of view in degree (angle between first and last beam)
+        float range; // sensor's maximum range in m
+        float resolution; // sensor's resolution in degree/beam
+        float start_angle; // angle of the first beam relative to the robot's heading in degree
         int n_measurements; // number of measurements obtained per sweep
+        Eigen::ArrayXf beam_angles; // angle of each beam relative to the robot's heading in rad
         Eigen::MatrixX2f measurements; // array of measurement values
         Eigen::Vector2f Q; // standard deviation of gaussian measurement noise
     
@@ -0,0 +1,188 @@
+//
+//  SensorLog.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 08.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "SensorLog.h"
+
+using namespace std;
+
+// Magic number and version of the log format
+static const char SENSOR_LOG_MAGIC[8] = {'F', 'S', 'L', 'A', 'M', 'L', 'O', 'G'};
+static const uint32_t SENSOR_LOG_VERSION = 2;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Log Recorder +++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Constructor, writes the header with the sensor geometry
+LogRecorder::LogRecorder(const string& file_path, Sensor& sensor, const float& sampling_time){
+
+    this->file_path = file_path;
+    this->file = fopen(file_path.c_str(), "wb");
+    if (this->file == nullptr) {
+        cout << "Unable to open sensor log " << file_path << " for writing!" << endl;
+        exit(1);
+    }
+
+    memcpy(this->header.magic, SENSOR_LOG_MAGIC, sizeof(SENSOR_LOG_MAGIC));
+    this->header.version = SENSOR_LOG_VERSION;
+    this->header.FoV = sensor.getFoV();
+    this->header.range = sensor.getRange();
+    this->header.resolution = sensor.getResolution();
+    this->header.start_angle = sensor.getStartAngle();
+    this->header.Q_r = sensor.getQ()(0);
+    this->header.Q_t = sensor.getQ()(1);
+    this->header.n_beams = sensor.getN();
+    this->header.sampling_time = sampling_time;
+    this->header.n_steps = 0;
+    fwrite(&this->header, sizeof(SensorLogHeader), 1, this->file);
+
+    this->buffer.resize(SENSOR_LOG_RECORD_OFFSET + this->header.n_beams);
+}
+
+// Destructor, closes the log if this did not happen yet
+LogRecorder::~LogRecorder(){
+    this->close();
+}
+
+// Append record of the current step
+void LogRecorder::record(const float& timestamp, const Eigen::Vector2f& odometry_signal, const Eigen::Vector3f& pose, Sensor& sensor){
+
+    if (this->file == nullptr) {
+        cout << "Sensor log " << this->file_path << " is already closed!" << endl;
+        exit(1);
+    }
+    if (sensor.getN() != this->header.n_beams) {
+        cout << "Number of beams changed while recording the sensor log!" << endl;
+        exit(1);
+    }
+
+    // Assemble record and write it at once
+    this->buffer[0] = timestamp;
+    this->buffer[1] = odometry_signal(0);
+    this->buffer[2] = odometry_signal(1);
+    this->buffer[3] = pose(0);
+    this->buffer[4] = pose(1);
+    this->buffer[5] = pose(2);
+    Eigen::Map<Eigen::VectorXf>(this->buffer.data() + SENSOR_LOG_RECORD_OFFSET, this->header.n_beams) = sensor.getMeasurements().col(1);
+    fwrite(this->buffer.data(), sizeof(float), this->buffer.size(), this->file);
+    this->header.n_steps++;
+}
+
+// Write number of records to the header and close the file
+void LogRecorder::close(){
+
+    if (this->file == nullptr) {
+        return; }
+
+    fseek(this->file, 0, SEEK_SET);
+    fwrite(&this->header, sizeof(SensorLogHeader), 1, this->file);
+    fclose(this->file);
+    this->file = nullptr;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++ Log Reader ++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Constructor, maps the log into memory and validates the header
+LogReader::LogReader(const string& file_path){
+
+    this->file_path = file_path;
+
+    int file_descriptor = open(file_path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        cout << "Unable to open sensor log " << file_path << "!" << endl;
+        exit(1);
+    }
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0) {
+        cout << "Unable to stat sensor log " << file_path << "!" << endl;
+        ::close(file_descriptor);
+        exit(1);
+    }
+    this->size = (size_t) file_stat.st_size;
+    if (this->size < sizeof(SensorLogHeader)) {
+        cout << "Sensor log " << file_path << " is too short to contain a header!" << endl;
+        exit(1);
+    }
+
+    // The mapping stays valid after closing the file descriptor
+    this->data = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    ::close(file_descriptor);
+    if (this->data == MAP_FAILED) {
+        cout << "Unable to map sensor log " << file_path << " into memory!" << endl;
+        exit(1);
+    }
+    // Records are read front to back
+    madvise(this->data, this->size, MADV_SEQUENTIAL);
+
+    this->header = (const SensorLogHeader*) this->data;
+    this->records = (const float*) ((const char*) this->data + sizeof(SensorLogHeader));
+
+    // Validate header
+    if (memcmp(this->header->magic, SENSOR_LOG_MAGIC, sizeof(SENSOR_LOG_MAGIC)) != 0) {
+        cout << file_path << " is not a sensor log!" << endl;
+        exit(1);
+    }
+    if (this->header->version != SENSOR_LOG_VERSION) {
+        cout << "Unsupported version " << this->header->version << " of sensor log " << file_path << "!" << endl;
+        exit(1);
+    }
+    const size_t record_size = (SENSOR_LOG_RECORD_OFFSET + this->header->n_beams) * sizeof(float);
+    if (this->header->n_beams <= 0 || this->header->n_steps <= 0 ||
+        this->size < sizeof(SensorLogHeader) + this->header->n_steps * record_size) {
+        cout << "Sensor log " << file_path << " is truncated or empty!" << endl;
+        exit(1);
+    }
+}
+
+// Destructor, unmaps the log
+LogReader::~LogReader(){
+    munmap(this->data, this->size);
+}
+
+// Check for the magic number of a sensor log
+bool LogReader::isSensorLog(const string& file_path){
+
+    char magic[sizeof(SENSOR_LOG_MAGIC)];
+    FILE* file = fopen(file_path.c_str(), "rb");
+    if (file == nullptr) {
+        return false; }
+    const bool is_sensor_log = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                               memcmp(magic, SENSOR_LOG_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return is_sensor_log;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void LogReader::summary(){
+
+    cout << "Sensor Log:" << endl;
+    cout << "-----------" << endl;
+    cout << "File: " << this->file_path << endl;
+    cout << "Steps: " << this->getNSteps() << endl;
+    cout << "Sampling Time: " << this->getSamplingTime() << "s" << endl;
+    cout << "FoV: " << this->getFoV() << "°" << endl;
+    cout << "Range: " << this->getRange() << "m" << endl;
+    cout << "Resolution: " << this->getResolution() << "°" << endl;
+    cout << "Start Angle: " << this->getStartAngle() << "°" << endl;
+    cout << "Number of Measurements: " << this->getNBeams() << endl;
+}
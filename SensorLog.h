@@ -0,0 +1,120 @@
+//
+//  SensorLog.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 08.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef SensorLog_h
+#define SensorLog_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+#include "Sensor.h"
+
+using namespace std;
+
+// Binary log of the filter input. The file starts with a header describing the sensor, followed by one record
+// per step. Every record has the same size: timestamp (1 float), odometry (v, omega), ground truth pose
+// (x, y, theta) and the range of every beam. The first record holds the initial scan at the initial pose.
+// All values are stored in native byte order, so logs are only portable between machines of equal endianness.
+typedef struct {
+    char magic[8]; // "FSLAMLOG"
+    uint32_t version; // version of the log format
+    float FoV; // sensor's field of view in degree
+    float range; // sensor's maximum range in m
+    float resolution; // sensor's resolution in degree/beam
+    float start_angle; // angle of the first beam relative to the robot's heading in degree
+    float Q_r; // standard deviation of the range noise
+    float Q_t; // standard deviation of the angle noise
+    int32_t n_beams; // number of ranges per record
+    float sampling_time; // nominal time between two records in s
+    int32_t n_steps; // number of records
+} SensorLogHeader;
+
+// Number of floats preceding the ranges in every record (timestamp, odometry, pose)
+const int SENSOR_LOG_RECORD_OFFSET = 6;
+
+
+// Writes a sensor log record by record. The number of records in the header is updated when the log is closed.
+class LogRecorder {
+
+    public:
+        // Constructor and destructor
+        LogRecorder(const string& file_path, Sensor& sensor, const float& sampling_time);
+        ~LogRecorder();
+
+        LogRecorder(const LogRecorder& recorder) = delete;
+        LogRecorder& operator=(const LogRecorder& recorder) = delete;
+
+        // Append record of the current step
+        void record(const float& timestamp, const Eigen::Vector2f& odometry_signal, const Eigen::Vector3f& pose, Sensor& sensor);
+
+        // Write number of records to the header and close the file
+        void close();
+
+    private:
+        FILE* file;
+        string file_path;
+        SensorLogHeader header;
+        vector<float> buffer; // record assembled before writing
+
+};
+
+
+// Memory-mapped read access to a sensor log. Records are not copied, the getters return views into the mapped
+// file which stay valid as long as the reader exists.
+class LogReader {
+
+    public:
+        // Constructor and destructor
+        LogReader(const string& file_path);
+        ~LogReader();
+
+        LogReader(const LogReader& reader) = delete;
+        LogReader& operator=(const LogReader& reader) = delete;
+
+        // Print log summary
+        void summary();
+
+        // Check if a file starts with the header of a sensor log
+        static bool isSensorLog(const string& file_path);
+
+        // Record getters
+        float getTimestamp(const int& step) const { return this->getRecord(step)[0]; };
+        Eigen::Map<const Eigen::Vector2f> getOdometry(const int& step) const {
+            return Eigen::Map<const Eigen::Vector2f>(this->getRecord(step) + 1); };
+        Eigen::Map<const Eigen::Vector3f> getPose(const int& step) const {
+            return Eigen::Map<const Eigen::Vector3f>(this->getRecord(step) + 3); };
+        Eigen::Map<const Eigen::VectorXf> getRanges(const int& step) const {
+            return Eigen::Map<const Eigen::VectorXf>(this->getRecord(step) + SENSOR_LOG_RECORD_OFFSET, this->header->n_beams); };
+
+        // Header getters
+        const int& getNSteps() const { return this->header->n_steps; };
+        const float& getFoV() const { return this->header->FoV; };
+        const float& getRange() const { return this->header->range; };
+        const float& getResolution() const { return this->header->resolution; };
+        const float& getStartAngle() const { return this->header->start_angle; };
+        Eigen::Vector2f getQ() const { return Eigen::Vector2f(this->header->Q_r, this->header->Q_t); };
+        const int& getNBeams() const { return this->header->n_beams; };
+        const float& getSamplingTime() const { return this->header->sampling_time; };
+
+    private:
+        // Pointer to the first value of a record
+        const float* getRecord(const int& step) const {
+            return this->records + (size_t) step * (SENSOR_LOG_RECORD_OFFSET + this->header->n_beams); };
+
+        string file_path;
+        void* data; // mapped file
+        size_t size; // size of the mapped file in bytes
+        const SensorLogHeader* header;
+        const float* records;
+
+};
+
+#endif /* SensorLog_h */
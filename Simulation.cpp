@@ -14,6 +14,9 @@
 
 #include "Simulation.h"
 #include "Sensor.h"
+#include "RandomStream.h"
+#include "Profiler.h"
+#include "Tracer.h"
 
 class Map;
 
@@ -26,7 +29,7 @@ using namespace std;
 // ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-Simulation::Simulation(const string& data_dir, const string& wall_filename, const string& parameter_filename, const string& control_signal_filename, const int simulation_mode, int verbose, SaveOptions save_options){
+Simulation::Simulation(const string& data_dir, const string& wall_filename, const string& parameter_filename, const string& control_signal_filename, const int simulation_mode, int verbose, SaveOptions save_options, unsigned int seed, bool headless, const string& replay_filename){
     
     
     // +++++++++++++++++++++++ Set simulation parameters and read-in files +++++++++++++++++++++++++++++++++++
@@ -41,14 +44,37 @@ Simulation::Simulation(const string& data_dir, const string& wall_filename, cons
     } // Set verbose to 0 in mapping mode
     this->verbose = verbose;
     
+    // Set headless mode
+    this->headless = headless;
+    
+    // Set seed of all random streams (runs with the same seed are reproducible independent of the number
+    // of threads)
+    this->seed = seed;
+    RandomStream::setSeed(seed);
+    
     // Set save options
     this->save_options = save_options;
     // Check if specified result directory exists and create if not
     bool result_dir_exists = std::__fs::filesystem::exists(save_options.result_dir);
-     if (save_options.save == true && result_dir_exists == false){
+     if ((save_options.save == true || save_options.profile == true || save_options.trace == true || save_options.record == true) && result_dir_exists == false){
          std::__fs::filesystem::create_directory(save_options.result_dir);
      }
     
+    // Create directories for scenes and maps once and start background writer for the images, maps are appended
+    // to the map history instead if requested
+    if (save_options.save == true){
+        std::__fs::filesystem::create_directory(save_options.result_dir + "/Scenes");
+        if ((simulation_mode == 1 || simulation_mode == 2) && save_options.map_history == true){
+            this->map_history = make_shared<MapHistoryWriter>(save_options.result_dir + "/map_history.bin", save_options.map_keyframe_interval);}
+        else if (simulation_mode == 1 || simulation_mode == 2){
+            std::__fs::filesystem::create_directory(save_options.result_dir + "/Maps");}
+        this->result_writer = make_shared<ResultWriter>(save_options.writer_threads, save_options.writer_capacity, save_options.writer_policy);
+    }
+    
+    // Enable instrumentation of the filter if a profile or trace is requested
+    Profiler::setEnabled(save_options.profile);
+    Tracer::setEnabled(save_options.trace);
+    
     // Set filename variables
     this->data_dir = data_dir;
     this->wall_filename = wall_filename;
@@ -58,11 +84,53 @@ Simulation::Simulation(const string& data_dir, const string& wall_filename, cons
     // Read in wall coordinates
     this->read_wall_file();
     
-    // Read in simulation parameters
+    // Read in simulation parameters (optional parameters are set to their defaults first)
+    this->n_threads = 0; // one worker thread per hardware thread
+    this->map_representation = 0; // one grid map per particle
+    this->mapping_mode = 0; // inverse sensor model on all cells within range
+    this->measurement_model = 0; // beam model on ray-cast measurement estimates
+    this->resampling_method = 0; // systematic resampling
+    this->kld_sampling = 0; // fixed number of particles
+    this->n_particles_min = 5;
+    this->n_particles_max = 50;
+    this->kld_epsilon = 0.05;
+    this->kld_z = 2.326; // delta = 0.01
+    this->kld_bin_size_xy = 0.25;
+    this->kld_bin_size_theta = 10 * PI / 180;
+    this->scan_matching_mode = 0; // ICP on estimated scans
+    this->search_window_linear = 0.5; // search window of the correlative matcher in m
+    this->search_window_angular = 10 * PI / 180; // search window of the correlative matcher in rad
     this->read_parameter_file();
     
-    // Read in control signals
-    this->read_control_signal_file();
+    // Read in control signals or open log to replay. A recorded sensor log provides odometry, ground truth
+    // poses and scans of all steps, its sensor geometry and sampling time replace the specified parameters.
+    // Text logs in CARMEN format are streamed, their sensor geometry replaces the specified parameters and
+    // odometry poses are used as ground truth.
+    this->n_beams = 0; // number of beams derived from field of view and resolution
+    if (replay_filename.empty()){
+        this->read_control_signal_file();
+    }
+    else if (LogReader::isSensorLog(replay_filename)){
+        this->log_reader = make_shared<LogReader>(replay_filename);
+        this->FoV = this->log_reader->getFoV();
+        this->range = this->log_reader->getRange();
+        this->sensor_resolution = this->log_reader->getResolution();
+        this->sensor_start_angle = this->log_reader->getStartAngle();
+        this->n_beams = this->log_reader->getNBeams();
+        this->Q = this->log_reader->getQ();
+        this->sampling_time = this->log_reader->getSamplingTime();
+        cout << "Sensor parameters and sampling time set from sensor log " << replay_filename << "." << endl;
+    }
+    else {
+        this->carmen_reader = make_shared<CarmenReader>(replay_filename, this->range);
+        this->FoV = this->carmen_reader->getFoV();
+        this->range = this->carmen_reader->getRange();
+        this->sensor_resolution = this->carmen_reader->getResolution();
+        this->sensor_start_angle = this->carmen_reader->getStartAngle();
+        this->n_beams = this->carmen_reader->getNBeams();
+        this->sampling_time = this->carmen_reader->getSamplingTime();
+        cout << "Sensor geometry and sampling time set from CARMEN log " << replay_filename << "." << endl;
+    }
     
 
     // +++++++++++++++++++++++ Create and initialize simulation components +++++++++++++++++++++++++++++++++++
@@ -72,8 +140,18 @@ Simulation::Simulation(const string& data_dir, const string& wall_filename, cons
 
     // Create all required robot components (Sensor and Rao-Blackwellized Particle Filter)
     if (this->simulation_mode == 1){ this->n_particles = 1; }  // set n_particles to 1 in mapping mode
-    RBPF filter = RBPF(n_particles, R, max_iterations, tolerance, discard_fraction);
-    Sensor sensor = Sensor(FoV, range, sensor_resolution, Q);
+    if (this->simulation_mode == 0 && this->map_representation != 0){
+        this->map_representation = 0;
+        cout << "Map representation set to 0 in Localization mode. Particles use the ground truth map." << endl;
+    } // Particles share the ground truth map in localization mode
+    RBPF filter = RBPF(n_particles, R, max_iterations, tolerance, discard_fraction, n_threads, map_representation, mapping_mode, scan_matching_mode, search_window_linear, search_window_angular, measurement_model);
+    Resampler resampler = Resampler(resampling_method);
+    filter.setResampler(resampler);
+    filter.setVerbose(this->verbose);
+    if (this->kld_sampling == 1 && this->simulation_mode != 1){
+        filter.setKLDSampling(n_particles_min, n_particles_max, kld_epsilon, kld_z, kld_bin_size_xy, kld_bin_size_theta);
+    } // Adapt number of particles during localization and SLAM
+    Sensor sensor = (this->n_beams > 0) ? Sensor(sensor_start_angle, sensor_resolution, n_beams, range, Q) : Sensor(FoV, range, sensor_resolution, Q);
     
     // Create robot object
     Robot robot = Robot();
@@ -85,14 +163,31 @@ Simulation::Simulation(const string& data_dir, const string& wall_filename, cons
     // Place robot in area
     this->area.setRobot(robot);
     
-    // Perform initial sensor sweep and mapping
-    this->area.getRobot().getSensor().sweep(this->wall_coordinates, this->area.getRobot().getPose());
+    // Perform initial sensor sweep (or place robot at the initial pose of the log) and mapping
+    if (this->log_reader == nullptr && this->carmen_reader == nullptr){
+        this->area.getRobot().getSensor().sweep(this->wall_coordinates, this->area.getRobot().getPose());
+    }
+    else {
+        Robot& robot = this->area.getRobot();
+        if (this->log_reader != nullptr){
+            robot.setPose(this->log_reader->getPose(0));
+            robot.getSensor().setRanges(this->log_reader->getRanges(0));
+        }
+        else {
+            robot.setPose(this->carmen_reader->getPose());
+            robot.getSensor().setRanges(this->carmen_reader->getRanges());
+        }
+        robot.setTimestamp(0.0);
+        for (int particle_id = 0; particle_id < robot.getFilter().getParticles().size(); particle_id++){
+            robot.getFilter().getParticles().setPose(particle_id, robot.getPose());
+        }
+    }
     this->area.getRobot().getFilter().mapping(this->area.getRobot().getSensor());
     this->area.getRobot().getFilter().sweep_estimate(this->area.getRobot().getSensor());
     
     // Set time variables
     this->start_time = 0.0; // Start time of the simulation
-    this->end_time = this->control_signals.size() * this->sampling_time + this->start_time; // End time of the simulation computed from number of provided control signals and specified sampling time
+    this->end_time = max(this->getNSteps(), 0) * this->sampling_time + this->start_time; // End time of the simulation computed from number of steps and specified sampling time (unknown for streamed logs)
     
     // Print simulation summary
     this->summary();
@@ -261,7 +356,7 @@ void Simulation::setParamters(){
             case OccupancyThreshold: this->occupancy_threshold = (*it).value;
                 break;
                 // Sensor Parameters
-            case FOV: this->FoV = (int)(*it).value;
+            case FOV: this->FoV = (*it).value;
                 break;
             case Range: this->range = (*it).value;
                 break;
@@ -280,13 +375,43 @@ void Simulation::setParamters(){
                 break;
             case Rt: this->R(2) = (*it).value;
                 break;
+            case NThreads: this->n_threads = (int)(*it).value;
+                break;
+            case MapRepresentation: this->map_representation = (int)(*it).value;
+                break;
+            case MappingMode: this->mapping_mode = (int)(*it).value;
+                break;
+            case MeasurementModel: this->measurement_model = (int)(*it).value;
+                break;
+            case ResamplingMethod: this->resampling_method = (int)(*it).value;
+                break;
+            case KLDSampling: this->kld_sampling = (int)(*it).value;
+                break;
+            case nParticlesMin: this->n_particles_min = (int)(*it).value;
+                break;
+            case nParticlesMax: this->n_particles_max = (int)(*it).value;
+                break;
+            case KLDEpsilon: this->kld_epsilon = (*it).value;
+                break;
+            case KLDZ: this->kld_z = (*it).value;
+                break;
+            case KLDBinSizeXY: this->kld_bin_size_xy = (*it).value;
+                break;
+            case KLDBinSizeTheta: this->kld_bin_size_theta = (*it).value * PI / 180;
+                break;
                 // Scan Matcher
+            case ScanMatchingMode: this->scan_matching_mode = (int)(*it).value;
+                break;
             case MaxIterations: this->max_iterations = (int)(*it).value;
                 break;
             case Tolerance: this->tolerance = (*it).value;
                 break;
             case DiscardFraction: this->discard_fraction = (*it).value / 100;
                 break;
+            case SearchWindowLinear: this->search_window_linear = (*it).value;
+                break;
+            case SearchWindowAngular: this->search_window_angular = (*it).value * PI / 180;
+                break;
                 // Error Case
             case Error: cout << "No corresponding variable for parameter " << (*it).name << endl;
                 break;
@@ -376,8 +501,18 @@ void Simulation::summary(){
     cout << "++++++++++++++++++" << endl;
     cout << "Mode: " << simulation_modes[this->simulation_mode] << endl;
     cout << "Verbosity: " << this->verbose << endl;
+    cout << "Headless: " << (this->headless ? "true" : "false") << endl;
+    cout << "Seed: " << this->seed << endl;
     // Print area summary
     this->getArea().summary();
+    // Print summary of the replayed sensor log
+    if (this->log_reader != nullptr){
+        this->log_reader->summary();}
+    if (this->carmen_reader != nullptr){
+        this->carmen_reader->summary();}
+    // Print summary of the result writer
+    if (this->result_writer != nullptr){
+        this->result_writer->summary();}
     cout << "++++++++++++++++++" << endl;
 }
 
@@ -393,47 +528,144 @@ void Simulation::run(){
     this->simulation_time = this->start_time;
     
     // Draw initial scene, draw initial map in mapping and SLAM mode
-    this->area.drawScene(this->verbose);
-    if (this->simulation_mode == 1 || this->simulation_mode == 2){
-        this->getArea().getRobot().getFilter().getMap().draw();}
+    if (this->headless == false){
+        this->area.drawScene(this->verbose);
+        if (this->simulation_mode == 1 || this->simulation_mode == 2){
+            this->getArea().getRobot().getFilter().getMap().draw();}
     
-    // Wait for keypress to start the simulation
-    cout << "Press key to start simulation!" << endl;
-    cv::waitKey();
+        // Wait for keypress to start the simulation
+        cout << "Press key to start simulation!" << endl;
+        cv::waitKey();
+    }
     
     // Get reference to robot
     Robot& robot = this->area.getRobot();
     
-    // Iterate over provided control signals (number of specified control signals and sampling time specify
-    // duration of the simulation)
-    for (vector<Eigen::Vector2f>::iterator it = this->control_signals.begin(); it != this->control_signals.end(); it++){
+    // Record sensor log, starting with the initial scan
+    shared_ptr<LogRecorder> log_recorder;
+    if (this->save_options.record == true){
+        log_recorder = make_shared<LogRecorder>(this->save_options.result_dir + "/sensor_log.bin", robot.getSensor(), this->sampling_time);
+        log_recorder->record(robot.getTimestamp(), Eigen::Vector2f::Zero(), robot.getPose(), robot.getSensor());
+    }
+    
+    // Iterate over provided control signals, recorded steps or scans of a streamed log (number of steps and
+    // sampling time specify duration of the simulation)
+    Eigen::Vector2f odometry_signal;
+    for (int step = 0; this->next_step(step, odometry_signal); step++){
         
-        // Set robot's velocities to current control signal
-        robot.setV((*it)(0));
-        robot.setOmega((*it)(1));
+        TRACE_SCOPE("simulation_step");
         
-        // Drive robot
-        Eigen::Vector2f odometry_signal = robot.drive(this->sampling_time);
-        
-        // Sensor sweep
-        robot.getSensor().sweep(this->wall_coordinates, robot.getPose());
+        // Record filter input of the current step
+        if (log_recorder != nullptr){
+            log_recorder->record(robot.getTimestamp(), odometry_signal, robot.getPose(), robot.getSensor());
+        }
         
         // Run particle filter
         robot.getFilter().run(robot, odometry_signal, this->simulation_mode);
+        Profiler::end_step();
         
         // Set current simulation time
         this->simulation_time += this->sampling_time;
         
         // Draw simulation
-        this->area.drawScene(this->verbose);
-        // Draw map only for simulation mode mapping and SLAM
-        if (this->simulation_mode == 1 || this->simulation_mode == 2){
-            this->getArea().getRobot().getFilter().getMap().draw();}
+        if (this->headless == false){
+            this->area.drawScene(this->verbose);
+            // Draw map only for simulation mode mapping and SLAM
+            if (this->simulation_mode == 1 || this->simulation_mode == 2){
+                this->getArea().getRobot().getFilter().getMap().draw();}
+        }
+        // In headless mode only extend the robot path, the scene is rendered when results are saved
+        else {
+            this->area.drawPath();
+        }
         
         // Save results
-        this->save_results(it);
+        this->save_results(this->is_last_step(step));
+        
+    }
+    
+    // Wait for all images to be written
+    if (this->result_writer != nullptr){
+        this->result_writer->flush();
+        if (this->result_writer->getNDropped() > 0){
+            cout << "Dropped " << this->result_writer->getNDropped() << " of " << this->result_writer->getNDropped() + this->result_writer->getNWritten() << " images from the full queue of the result writer." << endl;}
+    }
+    
+    // Close map history
+    if (this->map_history != nullptr){
+        this->map_history->close();
+        cout << "Map history: " << this->map_history->getNFrames() << " frames, " << this->map_history->getNTiles() << " tiles, " << this->map_history->getNBytes() << " bytes." << endl;
+    }
+    
+    // Write number of recorded steps to the sensor log
+    if (log_recorder != nullptr){
+        log_recorder->close();
+    }
+    
+    // Report and save profile of the filter
+    if (this->save_options.profile == true){
+        Profiler::summary();
+        Profiler::save(this->save_options.result_dir);
+    }
+    if (this->save_options.trace == true){
+        Tracer::save(this->save_options.result_dir + "/trace.json");
+    }
+}
+
+
+// Advance robot by one step of the control signals or the replayed log, returns false if no step is left
+bool Simulation::next_step(const int& step, Eigen::Vector2f& odometry_signal){
+    
+    // Get reference to robot
+    Robot& robot = this->area.getRobot();
+    
+    // Take odometry, ground truth pose and scan from the sensor log (record 0 holds the initial scan)
+    if (this->log_reader != nullptr){
+        if (step + 1 >= this->log_reader->getNSteps()){
+            return false;}
+        odometry_signal = this->log_reader->getOdometry(step + 1);
+        robot.setPose(this->log_reader->getPose(step + 1));
+        robot.setTimestamp(this->log_reader->getTimestamp(step + 1) - this->log_reader->getTimestamp(0));
+        robot.getSensor().setRanges(this->log_reader->getRanges(step + 1));
+    }
+    
+    // Take odometry, odometry pose and scan from the next scan of the CARMEN log
+    else if (this->carmen_reader != nullptr){
+        if (this->carmen_reader->next() == false){
+            return false;}
+        odometry_signal = this->carmen_reader->getOdometry();
+        robot.setPose(this->carmen_reader->getPose());
+        robot.setTimestamp(this->carmen_reader->getTimestamp());
+        robot.getSensor().setRanges(this->carmen_reader->getRanges());
+    }
+    
+    // Simulate robot motion and sensor sweep
+    else {
+        if (step >= (int) this->control_signals.size()){
+            return false;}
         
+        // Set robot's velocities to current control signal
+        robot.setV(this->control_signals[step](0));
+        robot.setOmega(this->control_signals[step](1));
+        
+        // Drive robot
+        odometry_signal = robot.drive(this->sampling_time);
+        
+        // Sensor sweep
+        robot.getSensor().sweep(this->wall_coordinates, robot.getPose());
     }
+    
+    return true;
+}
+
+// Check if the current step is the last step of the simulation
+bool Simulation::is_last_step(const int& step){
+    
+    // The end of a streamed log is only known after reading ahead
+    if (this->carmen_reader != nullptr){
+        return this->carmen_reader->isLast();}
+    
+    return step == this->getNSteps() - 1;
 }
 
 
@@ -442,7 +674,7 @@ void Simulation::run(){
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 // Save results
-void Simulation::save_results(vector<Eigen::Vector2f>::iterator it){
+void Simulation::save_results(const bool& last_step){
     
     // Set frequency trigger based on current iteration
     bool frequency_trigger;
@@ -450,10 +682,7 @@ void Simulation::save_results(vector<Eigen::Vector2f>::iterator it){
                                     this->sampling_time/2) / this->sampling_time);
     // If save frequency is 0, only save results after last iteration
     if (save_options.save_frequency == 0){
-        if (next(it) == this->control_signals.end()){
-            frequency_trigger = true;}
-        else {
-            frequency_trigger = false;}
+        frequency_trigger = last_step;
     }
     // If frequency > 0, trigger result saving according to specified frequency
     else {
@@ -461,9 +690,14 @@ void Simulation::save_results(vector<Eigen::Vector2f>::iterator it){
 
     // Save scene image in all modes and map in mapping and SLAM mode
     if (save_options.save == true && frequency_trigger == true){
+        if (this->headless == true){
+            this->area.renderScene(this->verbose);}
         cv::Mat scene_data = this->getArea().getData();
         this->save_image(scene_data, "Scenes", "scene");
-        if (this->simulation_mode == 1 || this->simulation_mode == 2){
+        if (this->map_history != nullptr && (this->simulation_mode == 1 || this->simulation_mode == 2)){
+            this->map_history->write(current_iteration, this->getArea().getRobot().getFilter().getMap());
+        }
+        else if (this->simulation_mode == 1 || this->simulation_mode == 2){
             cv::Mat map_data = this->getArea().getRobot().getFilter().getMap().getData();
             this->save_image(map_data, "Maps", "map");
         }
@@ -473,11 +707,7 @@ void Simulation::save_results(vector<Eigen::Vector2f>::iterator it){
 // Save image to file
 void Simulation::save_image(cv::Mat data, string save_dir, string name_prefix){
     
-    // Check if "Maps" directory exists and create if not
-    bool scene_dir_exists = std::__fs::filesystem::exists(save_options.result_dir + "/" + save_dir);
-    if (scene_dir_exists == false){
-        std::__fs::filesystem::create_directory(save_options.result_dir + "/" + save_dir);
-    }
+    TRACE_SCOPE("save_image");
     
     // Compute current iteration as image index
     int current_iteration = (int) ((this->simulation_time + this->sampling_time/2) / this->sampling_time);
@@ -485,7 +715,9 @@ void Simulation::save_image(cv::Mat data, string save_dir, string name_prefix){
     // Save image in specified directory
     string file_name = name_prefix + "_" + to_string(current_iteration) + ".png";
     string file_path = this->save_options.result_dir + "/" + save_dir + "/" + file_name;
-    cv::imwrite(file_path, data);
+    
+    // Hand copy of the image to the background writer
+    this->result_writer->write(data, file_path);
 }
 
 
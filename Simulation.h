@@ -13,9 +13,14 @@
 #include <Eigen/Dense>
 #include <opencv2/opencv.hpp>
 #include <vector>
+#include <memory>
 
 #include "Robot.h"
 #include "Area.h"
+#include "SensorLog.h"
+#include "CarmenReader.h"
+#include "ResultWriter.h"
+#include "MapHistory.h"
 
 using namespace std;
 
@@ -30,6 +35,14 @@ typedef struct {
     bool save;
     int save_frequency;
     string result_dir;
+    bool profile; // time filter stages and write profile.csv and profile.json to the result directory
+    bool trace; // record a timeline of the simulation and write trace.json to the result directory
+    bool record; // record odometry, ground truth poses and scans of all steps and write sensor_log.bin to the result directory
+    int writer_threads; // number of threads encoding saved images in the background
+    int writer_capacity; // maximum number of images waiting to be written
+    int writer_policy; // behavior if the queue of images is full | 0 = block simulation, 1 = drop oldest image
+    bool map_history; // append saved maps to map_history.bin in the result directory instead of writing one image per map
+    int map_keyframe_interval; // number of frames of the map history from one full map to the next
 } SaveOptions;
 
 // Enum for reading in relevant simulation parameters
@@ -56,6 +69,21 @@ enum parameter_id{
     MaxIterations,
     Tolerance,
     DiscardFraction,
+    NThreads,
+    MapRepresentation,
+    MappingMode,
+    ScanMatchingMode,
+    SearchWindowLinear,
+    SearchWindowAngular,
+    MeasurementModel,
+    KLDSampling,
+    nParticlesMin,
+    nParticlesMax,
+    KLDEpsilon,
+    KLDZ,
+    KLDBinSizeXY,
+    KLDBinSizeTheta,
+    ResamplingMethod,
     Error
 };
 
@@ -83,6 +111,21 @@ const string parameter_names []{
     "max_iterations",
     "tolerance",
     "discard_fraction",
+    "n_threads",
+    "map_representation",
+    "mapping_mode",
+    "scan_matching_mode",
+    "search_window_linear",
+    "search_window_angular",
+    "measurement_model",
+    "kld_sampling",
+    "n_particles_min",
+    "n_particles_max",
+    "kld_epsilon",
+    "kld_z",
+    "kld_bin_size_xy",
+    "kld_bin_size_theta",
+    "resampling_method",
 };
 
 // String names of simulation modes
@@ -97,7 +140,7 @@ class Simulation {
     
     public:
         // Constructor and destructor
-        Simulation(const string& data_dir, const string& wall_filename, const string& parameter_filename, const string& control_signal_filename, const int simulation_mode, int verbose, SaveOptions save_options);
+        Simulation(const string& data_dir, const string& wall_filename, const string& parameter_filename, const string& control_signal_filename, const int simulation_mode, int verbose, SaveOptions save_options, unsigned int seed = 0, bool headless = false, const string& replay_filename = "");
         ~Simulation(){};
     
         // Read-in functions
@@ -111,16 +154,21 @@ class Simulation {
         // Getter functions
         Area& getArea(){ return this->area; };
         const vector<vector<float>>& getWallCoordinates(){ return this->wall_coordinates; };
+        int getNSteps(){ // number of steps after the initial scan, -1 if unknown (streamed log)
+            if (this->carmen_reader != nullptr){ return -1; }
+            return (this->log_reader == nullptr) ? (int) this->control_signals.size() : this->log_reader->getNSteps() - 1; };
     
         // Run simulation
         void run();
+        bool next_step(const int& step, Eigen::Vector2f& odometry_signal);
+        bool is_last_step(const int& step);
     
         // Print summary
         void summary();
     
         // Save results
         void save_image(cv::Mat data, string save_dir, string name_prefix);
-        void save_results(const vector<Eigen::Vector2f>::iterator it);
+        void save_results(const bool& last_step);
 
     private:
     
@@ -130,23 +178,46 @@ class Simulation {
         // Verbosity level
         int verbose;
     
+        // Headless mode (no windows are opened, scenes are only rendered when results are saved)
+        bool headless;
+    
         // Save options
         SaveOptions save_options;
     
+        // Seed of the random streams
+        unsigned int seed;
+    
         // Sensor parameters
-        int FoV;
+        float FoV;
         float range;
         float sensor_resolution;
+        float sensor_start_angle; // angle of the first beam of a replayed sensor in degree
+        int n_beams; // number of beams of a replayed sensor, 0 if derived from FoV and resolution
         Eigen::Vector2f Q;
     
         // Filter parameters
         int n_particles;
         Eigen::Vector3f R;
+        int n_threads;
+        int map_representation;
+        int mapping_mode;
+        int measurement_model;
+        int resampling_method;
+        int kld_sampling;
+        int n_particles_min;
+        int n_particles_max;
+        float kld_epsilon;
+        float kld_z;
+        float kld_bin_size_xy;
+        float kld_bin_size_theta;
     
         // ScanMatcher parameters
+        int scan_matching_mode;
         int max_iterations;
         float tolerance;
         float discard_fraction;
+        float search_window_linear;
+        float search_window_angular;
     
         // Area parameters
         float x_min;
@@ -179,6 +250,17 @@ class Simulation {
         vector<vector<float>> wall_coordinates; // vector containing wall coordinates
         vector<Parameter> parameters; // vector containing all simulation parameters
         vector<Eigen::Vector2f> control_signals; // vector containing all control signals
+    
+        // Recorded sensor log or streamed CARMEN log replacing control signals and sensor sweeps (empty if the
+        // simulation is not replayed)
+        shared_ptr<LogReader> log_reader;
+        shared_ptr<CarmenReader> carmen_reader;
+    
+        // Background writer of saved images (empty if no results are saved)
+        shared_ptr<ResultWriter> result_writer;
+    
+        // Writer of the delta-encoded map history (empty if maps are saved as images)
+        shared_ptr<MapHistoryWriter> map_history;
 
 };
 
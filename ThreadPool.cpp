@@ -0,0 +1,143 @@
+//
+//  ThreadPool.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 20.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++ Constructor/Destructor +++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+// Constructor. If n_threads is 0, one thread per hardware thread is used.
+ThreadPool::ThreadPool(int n_threads){
+
+    // Get number of threads
+    if (n_threads <= 0){
+        n_threads = max(1, (int)thread::hardware_concurrency());
+    }
+    this->n_threads = n_threads;
+
+    // Initialize job state
+    this->stop = false;
+    this->job = nullptr;
+    this->n_items = 0;
+    this->next_item = 0;
+    this->generation = 0;
+    this->n_finished = 0;
+
+    // Start worker threads (the calling thread is worker 0)
+    for (int worker_id = 1; worker_id < this->n_threads; worker_id++){
+        this->workers.push_back(thread(&ThreadPool::worker_loop, this, worker_id));
+    }
+}
+
+
+// Destructor. Stop and join all worker threads.
+ThreadPool::~ThreadPool(){
+
+    {
+        lock_guard<mutex> lock(this->job_mutex);
+        this->stop = true;
+    }
+    this->job_available.notify_all();
+
+    for (vector<thread>::iterator it = this->workers.begin(); it != this->workers.end(); it++){
+        (*it).join();
+    }
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++ Print Summary ++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void ThreadPool::summary(){
+
+    cout << "Thread Pool:" << endl;
+    cout << "------------" << endl;
+    cout << "Number of Threads: " << this->n_threads << endl;
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++ Parallel For +++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void ThreadPool::parallel_for(const int& n_items, const function<void(int, int)>& work){
+
+    // Process serially if there is nothing to distribute
+    if (this->workers.empty() || n_items <= 1){
+        for (int item_id = 0; item_id < n_items; item_id++){
+            work(item_id, 0);
+        }
+        return;
+    }
+
+    // Publish job and wake up workers
+    {
+        lock_guard<mutex> lock(this->job_mutex);
+        this->job = &work;
+        this->n_items = n_items;
+        this->next_item = 0;
+        this->n_finished = 0;
+        this->generation++;
+    }
+    this->job_available.notify_all();
+
+    // Calling thread takes part in the work
+    this->process_items(0);
+
+    // Wait for all workers to finish the job
+    unique_lock<mutex> lock(this->job_mutex);
+    this->job_done.wait(lock, [this]{ return this->n_finished == (int)this->workers.size(); });
+    this->job = nullptr;
+}
+
+
+// Main loop of the worker threads
+void ThreadPool::worker_loop(int worker_id){
+
+    long last_generation = 0;
+
+    while (true){
+
+        // Wait for new job or stop signal
+        {
+            unique_lock<mutex> lock(this->job_mutex);
+            this->job_available.wait(lock, [&]{ return this->stop || this->generation != last_generation; });
+            if (this->stop){
+                return;
+            }
+            last_generation = this->generation;
+        }
+
+        // Process items of the current job
+        this->process_items(worker_id);
+
+        // Report completion
+        {
+            lock_guard<mutex> lock(this->job_mutex);
+            this->n_finished++;
+        }
+        this->job_done.notify_one();
+    }
+}
+
+
+// Process items of the current job until none are left
+void ThreadPool::process_items(int worker_id){
+
+    int item_id;
+    while ((item_id = this->next_item.fetch_add(1)) < this->n_items){
+        (*this->job)(item_id, worker_id);
+    }
+}
@@ -0,0 +1,69 @@
+//
+//  ThreadPool.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 20.08.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+using namespace std;
+
+
+class ThreadPool {
+
+    public:
+        // Constructor and destructor
+        ThreadPool(int n_threads = 0);
+        ~ThreadPool();
+
+        // Disable copying, the pool owns its worker threads
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Print thread pool summary
+        void summary();
+
+        // Process items [0, n_items) in parallel and return once all items are done (barrier). The work
+        // function is called with the item ID and the ID of the worker processing it. The calling thread
+        // participates as worker 0.
+        void parallel_for(const int& n_items, const function<void(int, int)>& work);
+
+        // Getter functions
+        const int& getNThreads(){ return this->n_threads; };
+
+    private:
+        // Main loop of the worker threads
+        void worker_loop(int worker_id);
+
+        // Process items of the current job until none are left
+        void process_items(int worker_id);
+
+        int n_threads; // number of threads including the calling thread
+        vector<thread> workers; // worker threads
+
+        // Synchronization of workers
+        mutex job_mutex;
+        condition_variable job_available;
+        condition_variable job_done;
+        bool stop;
+
+        // Current job
+        const function<void(int, int)>* job;
+        int n_items; // number of items of the current job
+        atomic<int> next_item; // next item to be processed
+        long generation; // incremented for every job to wake up the workers
+        int n_finished; // number of workers that finished the current job
+
+};
+
+#endif /* ThreadPool_h */
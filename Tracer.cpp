@@ -0,0 +1,93 @@
+//
+//  Tracer.cpp
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 07.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#include <iostream>
+#include <fstream>
+
+#include "Tracer.h"
+
+using namespace std;
+
+// Initialize static members
+bool Tracer::enabled = false;
+chrono::steady_clock::time_point Tracer::origin = chrono::steady_clock::now();
+mutex Tracer::buffers_mutex;
+vector<unique_ptr<TraceBuffer>> Tracer::buffers;
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// ++++++++++++++++++++++++++++++++++++++++++++++++ Recording ++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void Tracer::setEnabled(bool enabled){
+    
+    Tracer::enabled = enabled;
+    Tracer::origin = chrono::steady_clock::now();
+    
+    // Register buffer of the main thread before worker threads record their first events
+    if (enabled) {
+        Tracer::getBuffer().main_thread = true; }
+}
+
+
+TraceBuffer& Tracer::getBuffer(){
+    
+    thread_local TraceBuffer* buffer = nullptr;
+    
+    if (buffer == nullptr) {
+        lock_guard<mutex> lock(Tracer::buffers_mutex);
+        Tracer::buffers.push_back(unique_ptr<TraceBuffer>(new TraceBuffer()));
+        buffer = Tracer::buffers.back().get();
+        buffer->thread_id = (int) Tracer::buffers.size() - 1;
+        buffer->main_thread = false;
+    }
+    
+    return *buffer;
+}
+
+
+void Tracer::record(const char* name, const chrono::steady_clock::time_point& start, const chrono::steady_clock::time_point& end){
+    
+    TraceEvent event;
+    event.name = name;
+    event.start = chrono::duration_cast<chrono::microseconds>(start - Tracer::origin).count();
+    event.duration = chrono::duration_cast<chrono::microseconds>(end - start).count();
+    Tracer::getBuffer().events.push_back(event);
+}
+
+
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++ Export ++++++++++++++++++++++++++++++++++++++++++++++++++
+// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+void Tracer::save(const string& file_path){
+    
+    ofstream file(file_path);
+    if (!file.is_open()) {
+        cout << "Unable to write trace to " << file_path << endl;
+        return;
+    }
+    
+    lock_guard<mutex> lock(Tracer::buffers_mutex);
+    
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << endl;
+    bool first = true;
+    for (vector<unique_ptr<TraceBuffer>>::const_iterator it = Tracer::buffers.begin(); it != Tracer::buffers.end(); it++) {
+        
+        // Name the thread in the viewer
+        file << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << (*it)->thread_id;
+        file << ", \"args\": {\"name\": \"" << ((*it)->main_thread ? "main" : "worker " + to_string((*it)->thread_id)) << "\"}}";
+        first = false;
+        
+        for (vector<TraceEvent>::const_iterator event = (*it)->events.begin(); event != (*it)->events.end(); event++) {
+            file << ",\n{\"name\": \"" << (*event).name << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << (*it)->thread_id;
+            file << ", \"ts\": " << (*event).start << ", \"dur\": " << (*event).duration << "}";
+        }
+    }
+    file << endl << "]}" << endl;
+}
@@ -0,0 +1,95 @@
+//
+//  Tracer.h
+//  FastSLAM
+//
+//  Created by Mats Steinweg on 07.09.19.
+//  Copyright © 2019 Mats Steinweg. All rights reserved.
+//
+
+#ifndef Tracer_h
+#define Tracer_h
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+
+using namespace std;
+
+// Complete event of the trace (name, start and duration in us, recording thread)
+typedef struct {
+    const char* name;
+    long long start;
+    long long duration;
+} TraceEvent;
+
+// Events recorded by a single thread
+typedef struct {
+    int thread_id;
+    bool main_thread; // buffer of the thread that enabled the tracer
+    vector<TraceEvent> events;
+} TraceBuffer;
+
+
+// Records the begin and end of scopes as complete events in the Chrome Trace Event format. Every thread writes
+// to its own buffer, which is registered once on the first event of the thread, so recording takes no lock.
+// Buffers are only read when the trace is saved after all work of the simulation finished. Names have to be
+// string literals or otherwise outlive the tracer.
+class Tracer {
+
+    public:
+        // Record event of the calling thread
+        static void record(const char* name, const chrono::steady_clock::time_point& start, const chrono::steady_clock::time_point& end);
+
+        // Write all events as Chrome Trace Event JSON (open in chrome://tracing or Perfetto)
+        static void save(const string& file_path);
+
+        // Static getter and setter, enabling the tracer starts the time line and registers the calling thread as
+        // the main thread
+        static const bool& isEnabled(){ return Tracer::enabled; };
+        static void setEnabled(bool enabled);
+
+    private:
+        // Buffer of the calling thread, created and registered on first use
+        static TraceBuffer& getBuffer();
+
+        static bool enabled;
+        static chrono::steady_clock::time_point origin; // time of enabling the tracer
+        static mutex buffers_mutex; // guards registration of new buffers
+        static vector<unique_ptr<TraceBuffer>> buffers; // event buffers of all threads
+
+};
+
+
+// Records the time between its construction and destruction as event of the trace
+class ScopedTrace {
+
+    public:
+        ScopedTrace(const char* name){
+            this->name = name;
+            this->active = Tracer::isEnabled();
+            if (this->active) {
+                this->start = chrono::steady_clock::now(); }
+        };
+        ~ScopedTrace(){
+            if (this->active) {
+                Tracer::record(this->name, this->start, chrono::steady_clock::now()); }
+        };
+
+    private:
+        const char* name;
+        bool active;
+        chrono::steady_clock::time_point start;
+
+};
+
+
+// Instrumentation macro, compiled out if FASTSLAM_NO_PROFILING is defined
+#ifdef FASTSLAM_NO_PROFILING
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_SCOPE(name) ScopedTrace scoped_trace(name)
+#endif
+
+#endif /* Tracer_h */
@@ -7,17 +7,14 @@
 //
 
 #include <stdio.h>
-#include <random>
 
 #include "WheelEncoder.h"
+#include "RandomStream.h"
 
 using namespace std;
 
 #define PI 3.14159265
 
-default_random_engine generator;
-normal_distribution<float> distribution(0.0, 1.0);
-
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 // ++++++++++++++++++++++++++++++++++++++++++++ Constructor ++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -35,6 +32,7 @@ WheelEncoder::WheelEncoder(){
     this->ticks_right = 0;
     this->ticks_left_prev = 0;
     this->ticks_right_prev = 0;
+    this->step = 0;
     
 }
 
@@ -46,9 +44,13 @@ WheelEncoder::WheelEncoder(){
 // Inverse odometry model
 void WheelEncoder::encode_motion(float v, float omega, const float& delta_t){
         
+    // Random stream of the encoder noise in the current step
+    RandomStream random(this->step, WHEEL_ENCODER_STREAM, 0);
+    this->step++;
+        
     // Apply uncorrelated noise to v and omega to model sensor inaccuracies due to friction and wind
-    v += (this->noise(0) * distribution(generator));
-    omega += (this->noise(1) * distribution(generator));
+    v += (this->noise(0) * random.normal());
+    omega += (this->noise(1) * random.normal());
     
     // Compute angular velocity of left and right wheel
     float omega_l = (2*v - omega*this->B) / (2*this->R_L);
@@ -30,6 +30,7 @@ class WheelEncoder {
         int ticks_right; // accumulated ticks of right wheel
         int ticks_left_prev; // accumulated ticks of left wheel at last timestamp
         int ticks_right_prev; // accumulated ticks of right wheel at last timestamp
+        int step; // number of encoded motions, used to key the random stream
 
 };
 
@@ -6,7 +6,7 @@
 //  Copyright © 2019 Mats Steinweg. All rights reserved.
 //
 
-#include "Particle.h"
+#include "ParticleSet.h"
 #include "Map.h"
 #include <list>
 #include <Eigen/Dense>
@@ -14,6 +14,7 @@
 #include "Robot.h"
 #include "ScanMatcher.h"
 #include "Simulation.h"
+#include "MapHistory.h"
 #include <typeinfo>
 
 using namespace std;
@@ -22,8 +23,62 @@ using namespace cv;
 int main(int argc, const char * argv[]) {
     
     
-    // Set simulation mode | 0 = Localization, 1 = Mapping, 2 = SLAM
-    int simulation_mode = 2;
+    // Parse command line options
+    string data_dir = "Data"; // directory containing walls.txt, parameters.txt and control_signals.txt
+    int simulation_mode = 2; // 0 = Localization, 1 = Mapping, 2 = SLAM
+    bool headless = false; // run without opening any windows, scenes are only rendered when results are saved
+    unsigned int seed = 0; // seed of the random streams, runs with identical seeds are reproducible
+    bool record = false; // record odometry, ground truth poses and scans to sensor_log.bin in the result directory
+    string replay_file = ""; // replay sensor log instead of simulating robot motion and sensor sweeps
+    bool map_history = false; // append saved maps to map_history.bin instead of writing one image per map
+    bool profile = false; // time filter stages and save profile.csv/profile.json to the result directory
+    bool trace = false; // record timeline of the simulation and save trace.json to the result directory
+    for (int arg_id = 1; arg_id < argc; arg_id++){
+        string arg = argv[arg_id];
+        if (arg == "--data" && arg_id + 1 < argc){
+            data_dir = argv[++arg_id];
+        }
+        else if (arg == "--mode" && arg_id + 1 < argc){
+            simulation_mode = (int) strtol(argv[++arg_id], 0, 10);
+            if (simulation_mode < 0 || simulation_mode > 2){
+                cout << "Invalid simulation mode: " << simulation_mode << " (0 = Localization, 1 = Mapping, 2 = SLAM)" << endl;
+                exit(1);
+            }
+        }
+        else if (arg == "--headless"){
+            headless = true;
+        }
+        else if (arg == "--seed" && arg_id + 1 < argc){
+            seed = (unsigned int) strtoul(argv[++arg_id], 0, 10);
+        }
+        else if (arg == "--record"){
+            record = true;
+        }
+        else if (arg == "--replay" && arg_id + 1 < argc){
+            replay_file = argv[++arg_id];
+        }
+        else if (arg == "--map-history"){
+            map_history = true;
+        }
+        else if (arg == "--profile"){
+            profile = true;
+        }
+        else if (arg == "--trace"){
+            trace = true;
+        }
+        else if (arg == "--extract-map" && arg_id + 3 < argc){
+            // Reconstruct the map of a step from a map history and exit
+            MapHistoryReader reader(argv[arg_id + 1]);
+            reader.summary();
+            cv::imwrite(argv[arg_id + 3], reader.readStep((int) strtol(argv[arg_id + 2], 0, 10)));
+            return 0;
+        }
+        else {
+            cout << "Unknown option: " << arg << endl;
+            cout << "Usage: " << argv[0] << " [--data DIR] [--mode 0|1|2] [--headless] [--seed N] [--record] [--replay FILE] [--map-history] [--profile] [--trace] [--extract-map HISTORY STEP OUTPUT]" << endl;
+            exit(1);
+        }
+    }
     
     // Set verbosity level
     int verbose = 2;
@@ -33,20 +88,28 @@ int main(int argc, const char * argv[]) {
     save_options.save = true;
     save_options.save_frequency = 0;  // frequency = 0 -> only save results at last timestep
     save_options.result_dir = "Results";
+    save_options.profile = profile; // time filter stages and save profile.csv/profile.json to the result directory
+    save_options.trace = trace; // record timeline of the simulation and save trace.json to the result directory
+    save_options.record = record; // record filter input and save sensor_log.bin to the result directory
+    save_options.writer_threads = 2; // threads encoding images in the background
+    save_options.writer_capacity = 8; // images waiting to be written before the policy applies
+    save_options.writer_policy = Block; // Block = wait for a free slot, DropOldest = discard oldest queued image
+    save_options.map_history = map_history; // append maps to map_history.bin in the result directory
+    save_options.map_keyframe_interval = 100; // frames between full maps in the map history
     
     // Create simulation
-    string data_dir = "Data";
     string walls_file_path = data_dir + "/" + "walls.txt";
     string parameters_file_path = data_dir + "/" + "parameters.txt";
     string control_signals_file_path = data_dir + "/" + "control_signals.txt";
-    Simulation *simulation = new Simulation(walls_file_path, parameters_file_path,
-                                            control_signals_file_path, simulation_mode, verbose, save_options);
+    Simulation *simulation = new Simulation(data_dir, walls_file_path, parameters_file_path,
+                                            control_signals_file_path, simulation_mode, verbose, save_options, seed, headless, replay_file);
     
     // Run simulation
     simulation->run();
     
     // Wait for keypress to close window
-    cv::waitKey();
+    if (headless == false){
+        cv::waitKey();}
     
     return 0;
 }